@@ -8,66 +8,172 @@
 #include <cstring>
 #include <cstdint>
 #include <cctype>
+#include <clocale>
 #include <new>
 #include <utility>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 #pragma comment(lib, "winhttp.lib")
+#ifdef GOONMC_PROFILE
+#include <psapi.h>
+#endif
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GOONMC_SSE2 1
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define GOONMC_TARGET(isa) __attribute__((target(isa)))
+#else
+#define GOONMC_TARGET(isa)
+#endif
 
 inline constexpr size_t NPOS = static_cast<size_t>(-1);
 
+static inline int ctz64(uint64_t x) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long r; _BitScanForward64(&r, x); return (int)r;
+#elif defined(_MSC_VER)
+    unsigned long r;
+    if (_BitScanForward(&r, (unsigned long)x)) return (int)r;
+    _BitScanForward(&r, (unsigned long)(x >> 32)); return (int)r + 32;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+#ifdef GOONMC_SSE2
+static bool cpu_has_avx2() {
+#ifdef _MSC_VER
+    int r[4];
+    __cpuid(r, 0);
+    if (r[0] < 7) return false;
+    __cpuid(r, 1);
+    if (!(r[2] & (1 << 27)) || !(r[2] & (1 << 28))) return false;   // OSXSAVE, AVX
+    if ((_xgetbv(0) & 6) != 6) return false;                         // OS saves YMM
+    __cpuidex(r, 7, 0);
+    return (r[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static bool cpu_has_sha() {
+#ifdef _MSC_VER
+    int r[4];
+    __cpuid(r, 0);
+    if (r[0] < 7) return false;
+    __cpuid(r, 1);
+    if (!(r[2] & (1 << 19))) return false;                           // SSE4.1
+    __cpuidex(r, 7, 0);
+    return (r[1] & (1 << 29)) != 0;
+#else
+    return __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1");
+#endif
+}
+#endif
+
+// Monotonic clock in milliseconds. Build with -DGOONMC_PROFILE to get
+// timing/allocation notes on stderr.
+static double now_ms() {
+    LARGE_INTEGER f, c;
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&c);
+    return (double)c.QuadPart * 1000.0 / (double)f.QuadPart;
+}
+
+#ifdef GOONMC_PROFILE
+// Page faults taken by the process so far. Across a parse of a mapped file
+// the delta is the number of pages touched; with the time it tells a read
+// served from the page cache apart from one that went to disk.
+static DWORD prof_faults() {
+    PROCESS_MEMORY_COUNTERS pmc{};
+    pmc.cb = sizeof(pmc);
+    GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
+    return pmc.PageFaultCount;
+}
+#endif
+
+// Strings of up to SSO_CAP characters are stored inline; longer ones spill to
+// the heap. The inline buffer is never pointed at by the object itself, so
+// both types stay safe to relocate with realloc inside Vec.
 struct Str {
-    char*  p;
+    static constexpr size_t SSO_CAP = 47;
     size_t n, cap;
-    Str() : p(nullptr), n(0), cap(0) {}
-    Str(const Str& o) : p(nullptr), n(0), cap(0) {
-        if (o.n) { p = (char*)malloc(o.n + 1); memcpy(p, o.p, o.n + 1); n = o.n; cap = o.n; }
-    }
-    Str(Str&& o) noexcept : p(o.p), n(o.n), cap(o.cap) { o.p = nullptr; o.n = 0; o.cap = 0; }
-    ~Str() { free(p); }
+    union { char* heap; char sso[SSO_CAP + 1]; };
+
+    Str() : n(0), cap(SSO_CAP) { sso[0] = 0; }
+    Str(const Str& o) : Str() { append(o.data(), o.n); }
+    Str(Str&& o) noexcept : n(0), cap(SSO_CAP) { take(o); }
+    ~Str() { if (is_heap()) free(heap); }
     Str& operator=(const Str& o) {
-        if (this != &o) { free(p); p = nullptr; n = 0; cap = 0; if (o.n) { p = (char*)malloc(o.n + 1); memcpy(p, o.p, o.n + 1); n = o.n; cap = o.n; } }
+        if (this != &o) { clear(); append(o.data(), o.n); }
         return *this;
     }
     Str& operator=(Str&& o) noexcept {
-        if (this != &o) { free(p); p = o.p; n = o.n; cap = o.cap; o.p = nullptr; o.n = 0; o.cap = 0; }
+        if (this != &o) { if (is_heap()) free(heap); take(o); }
         return *this;
     }
+    void take(Str& o) {
+        n = o.n; cap = o.cap;
+        if (o.is_heap()) heap = o.heap;
+        else             memcpy(sso, o.sso, n + 1);
+        o.n = 0; o.cap = SSO_CAP; o.sso[0] = 0;
+    }
+    bool        is_heap() const { return cap > SSO_CAP; }
+    char*       data()          { return is_heap() ? heap : sso; }
+    const char* data()    const { return is_heap() ? heap : sso; }
     void grow(size_t need) {
         if (n + need <= cap) return;
-        size_t nc = cap ? cap * 2 : 16;
+        size_t nc = cap * 2;
         if (nc < n + need) nc = n + need;
-        p = (char*)realloc(p, nc + 1);
+        if (is_heap()) {
+            heap = (char*)realloc(heap, nc + 1);
+        } else {
+            char* h = (char*)malloc(nc + 1);
+            memcpy(h, sso, n + 1);
+            heap = h;
+        }
         cap = nc;
     }
     void append(const char* s, size_t l) {
         if (!l) return; grow(l);
+        char* p = data();
         memcpy(p + n, s, l); n += l; p[n] = 0;
     }
-    void append_c(char c)        { grow(1); p[n++] = c; p[n] = 0; }
+    void append_c(char c)        { grow(1); char* p = data(); p[n++] = c; p[n] = 0; }
     void append_s(const char* s) { if (s && *s) append(s, strlen(s)); }
-    void assign(const char* s, size_t l) { n = 0; append(s, l); }
-    void assign_s(const char* s)         { n = 0; append_s(s); }
-    void copy_from(const Str& o)         { n = 0; if (o.p && o.n) append(o.p, o.n); }
-    const char* c_str() const { return p ? p : ""; }
+    void assign(const char* s, size_t l) { clear(); append(s, l); }
+    void assign_s(const char* s)         { clear(); append_s(s); }
+    void copy_from(const Str& o)         { if (this != &o) { clear(); append(o.data(), o.n); } }
+    void clear()                         { n = 0; data()[0] = 0; }
+    const char* c_str() const { return data(); }
     size_t size()  const { return n; }
     bool   empty() const { return n == 0; }
-    char   back()  const { return n ? p[n-1] : 0; }
-    void   pop_back()    { if (n) { --n; p[n] = 0; } }
-    char  operator[](size_t i) const { return p[i]; }
-    char& operator[](size_t i)       { return p[i]; }
+    char   back()  const { return n ? data()[n-1] : 0; }
+    void   pop_back()    { if (n) { --n; data()[n] = 0; } }
+    char  operator[](size_t i) const { return data()[i]; }
+    char& operator[](size_t i)       { return data()[i]; }
     bool eq(const char* s) const {
         size_t l = strlen(s);
-        return l == n && (!n || !memcmp(p, s, n));
+        return l == n && (!n || !memcmp(data(), s, n));
     }
     bool eq_n(const char* s, size_t l) const {
-        return l == n && (!n || !memcmp(p, s, n));
+        return l == n && (!n || !memcmp(data(), s, n));
     }
     size_t find(char c, size_t from = 0) const {
+        const char* p = data();
         for (size_t i = from; i < n; ++i) if (p[i] == c) return i;
         return NPOS;
     }
     size_t find_s(const char* s) const {
         size_t sl = strlen(s);
         if (sl > n) return NPOS;
+        const char* p = data();
         for (size_t i = 0; i <= n - sl; ++i) if (!memcmp(p + i, s, sl)) return i;
         return NPOS;
     }
@@ -76,62 +182,81 @@ struct Str {
         Str r{};
         if (from >= n) return r;
         if (len == NPOS || from + len > n) len = n - from;
-        r.append(p + from, len);
+        r.append(data() + from, len);
         return r;
     }
     void replace_range(size_t pos, size_t rlen, const char* rep) {
         size_t rl = strlen(rep);
+        const char* p = data();
         Str t{};
         if (pos) t.append(p, pos);
         t.append(rep, rl);
         if (pos + rlen <= n) t.append(p + pos + rlen, n - pos - rlen);
         *this = std::move(t);
     }
-    void to_lower() { for (size_t i = 0; i < n; ++i) p[i] = (char)tolower((uint8_t)p[i]); }
+    void to_lower() { char* p = data(); for (size_t i = 0; i < n; ++i) p[i] = (char)tolower((uint8_t)p[i]); }
     bool ends_with(const char* s) const {
         size_t l = strlen(s);
-        return n >= l && !memcmp(p + n - l, s, l);
+        return n >= l && !memcmp(data() + n - l, s, l);
     }
 };
 
 struct WStr {
-    wchar_t* p;
-    size_t   n, cap;
-    WStr() : p(nullptr), n(0), cap(0) {}
-    WStr(const WStr& o) : p(nullptr), n(0), cap(0) {
-        if (o.n) { p = (wchar_t*)malloc((o.n + 1)*sizeof(wchar_t)); memcpy(p, o.p, (o.n + 1)*sizeof(wchar_t)); n = o.n; cap = o.n; }
-    }
-    WStr(WStr&& o) noexcept : p(o.p), n(o.n), cap(o.cap) { o.p = nullptr; o.n = 0; o.cap = 0; }
-    ~WStr() { free(p); }
+    static constexpr size_t SSO_CAP = 23;
+    size_t n, cap;
+    union { wchar_t* heap; wchar_t sso[SSO_CAP + 1]; };
+
+    WStr() : n(0), cap(SSO_CAP) { sso[0] = 0; }
+    WStr(const WStr& o) : WStr() { append(o.data(), o.n); }
+    WStr(WStr&& o) noexcept : n(0), cap(SSO_CAP) { take(o); }
+    ~WStr() { if (is_heap()) free(heap); }
     WStr& operator=(const WStr& o) {
-        if (this != &o) { free(p); p = nullptr; n = 0; cap = 0; if (o.n) { p = (wchar_t*)malloc((o.n + 1)*sizeof(wchar_t)); memcpy(p, o.p, (o.n + 1)*sizeof(wchar_t)); n = o.n; cap = o.n; } }
+        if (this != &o) { clear(); append(o.data(), o.n); }
         return *this;
     }
     WStr& operator=(WStr&& o) noexcept {
-        if (this != &o) { free(p); p = o.p; n = o.n; cap = o.cap; o.p = nullptr; o.n = 0; o.cap = 0; }
+        if (this != &o) { if (is_heap()) free(heap); take(o); }
         return *this;
     }
+    void take(WStr& o) {
+        n = o.n; cap = o.cap;
+        if (o.is_heap()) heap = o.heap;
+        else             memcpy(sso, o.sso, (n + 1) * sizeof(wchar_t));
+        o.n = 0; o.cap = SSO_CAP; o.sso[0] = 0;
+    }
+    bool           is_heap() const { return cap > SSO_CAP; }
+    wchar_t*       data()          { return is_heap() ? heap : sso; }
+    const wchar_t* data()    const { return is_heap() ? heap : sso; }
     void grow(size_t need) {
         if (n + need <= cap) return;
-        size_t nc = cap ? cap * 2 : 16;
+        size_t nc = cap * 2;
         if (nc < n + need) nc = n + need;
-        p = (wchar_t*)realloc(p, (nc + 1) * sizeof(wchar_t));
+        if (is_heap()) {
+            heap = (wchar_t*)realloc(heap, (nc + 1) * sizeof(wchar_t));
+        } else {
+            wchar_t* h = (wchar_t*)malloc((nc + 1) * sizeof(wchar_t));
+            memcpy(h, sso, (n + 1) * sizeof(wchar_t));
+            heap = h;
+        }
         cap = nc;
     }
     void append(const wchar_t* s, size_t l) {
         if (!l) return; grow(l);
+        wchar_t* p = data();
         memcpy(p + n, s, l * sizeof(wchar_t)); n += l; p[n] = 0;
     }
-    void append_c(wchar_t c)        { grow(1); p[n++] = c; p[n] = 0; }
+    void append_c(wchar_t c)        { grow(1); wchar_t* p = data(); p[n++] = c; p[n] = 0; }
     void append_w(const wchar_t* s) { if (s && *s) append(s, wcslen(s)); }
-    void assign_w(const wchar_t* s) { n = 0; append_w(s); }
-    void copy_from(const WStr& o)   { n = 0; if (o.p && o.n) append(o.p, o.n); }
-    const wchar_t* c_str() const { return p ? p : L""; }
+    void assign_w(const wchar_t* s) { clear(); append_w(s); }
+    void copy_from(const WStr& o)   { if (this != &o) { clear(); append(o.data(), o.n); } }
+    void clear()                    { n = 0; data()[0] = 0; }
+    const wchar_t* c_str() const { return data(); }
     size_t size()  const { return n; }
     bool   empty() const { return n == 0; }
-    wchar_t back() const { return n ? p[n-1] : 0; }
-    void pop_back()      { if (n) { --n; p[n] = 0; } }
+    wchar_t back() const { return n ? data()[n-1] : 0; }
+    void pop_back()      { if (n) { --n; data()[n] = 0; } }
     size_t find(wchar_t c, size_t from = 0) const {
+        const wchar_t* p = data();
         for (size_t i = from; i < n; ++i) if (p[i] == c) return i;
         return NPOS;
     }
@@ -175,208 +300,794 @@ struct Vec {
     void   pop_back()    { if (n) { --n; p[n].~T(); } }
 };
 
-struct JVal {
-    enum Type : uint8_t { Null_, Bool_, Num_, Str_, Arr_, Obj_ } type;
-    bool   bval;
-    double nval;
-    Str    sval;
-    JVal*  arr;      size_t arr_n, arr_cap;
-    Str*   obj_keys; JVal*  obj_vals; size_t obj_n, obj_cap;
-
-    JVal() : type(Null_), bval(false), nval(0), arr(nullptr), arr_n(0), arr_cap(0), obj_keys(nullptr), obj_vals(nullptr), obj_n(0), obj_cap(0) {}
-    JVal(JVal&& o) noexcept : type(o.type), bval(o.bval), nval(o.nval), sval(std::move(o.sval)),
-                              arr(o.arr), arr_n(o.arr_n), arr_cap(o.arr_cap),
-                              obj_keys(o.obj_keys), obj_vals(o.obj_vals), obj_n(o.obj_n), obj_cap(o.obj_cap) {
-        o.type = Null_; o.arr = nullptr; o.obj_keys = nullptr; o.obj_vals = nullptr;
-        o.arr_n = 0; o.arr_cap = 0; o.obj_n = 0; o.obj_cap = 0;
-    }
-    ~JVal() {
-        if (type == Arr_) {
-            for (size_t i = 0; i < arr_n; ++i) arr[i].~JVal();
-            free(arr);
-        } else if (type == Obj_) {
-            for (size_t i = 0; i < obj_n; ++i) {
-                obj_keys[i].~Str();
-                obj_vals[i].~JVal();
-            }
-            free(obj_keys);
-            free(obj_vals);
-        }
-    }
-    JVal& operator=(JVal&& o) noexcept {
+// Bump allocator for JSON documents: every node, child array and string of a
+// parsed document lives in a handful of large blocks that are released together.
+struct Arena {
+    struct Block { Block* next; size_t used, cap; };
+    Block* head;
+    size_t nblocks;
+    size_t min_block;
+    Arena() : head(nullptr), nblocks(0), min_block(65536) {}
+    Arena(Arena&& o) noexcept : head(o.head), nblocks(o.nblocks), min_block(o.min_block) { o.head = nullptr; o.nblocks = 0; }
+    ~Arena() { release(); }
+    Arena& operator=(Arena&& o) noexcept {
         if (this != &o) {
-            this->~JVal();
-            type = o.type; bval = o.bval; nval = o.nval; sval = std::move(o.sval);
-            arr = o.arr; arr_n = o.arr_n; arr_cap = o.arr_cap;
-            obj_keys = o.obj_keys; obj_vals = o.obj_vals; obj_n = o.obj_n; obj_cap = o.obj_cap;
-            o.type = Null_; o.arr = nullptr; o.obj_keys = nullptr; o.obj_vals = nullptr;
-            o.arr_n = 0; o.arr_cap = 0; o.obj_n = 0; o.obj_cap = 0;
+            release();
+            head = o.head; nblocks = o.nblocks; min_block = o.min_block;
+            o.head = nullptr; o.nblocks = 0;
         }
         return *this;
     }
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    void release() {
+        while (head) { Block* b = head->next; free(head); head = b; }
+        nblocks = 0;
+    }
+    void* alloc(size_t sz, size_t al = alignof(double)) {
+        if (head) {
+            size_t off = (head->used + al - 1) & ~(al - 1);
+            if (off + sz <= head->cap) { head->used = off + sz; return (char*)(head + 1) + off; }
+        }
+        size_t cap = min_block;
+        if (head && head->cap * 2 > cap) cap = head->cap * 2;
+        if (cap < sz + al) cap = sz + al;
+        Block* b = (Block*)malloc(sizeof(Block) + cap);
+        b->next = head; b->used = 0; b->cap = cap;
+        head = b; ++nblocks;
+        size_t off = ((size_t)(uintptr_t)(b + 1) & (al - 1)) ? al - ((size_t)(uintptr_t)(b + 1) & (al - 1)) : 0;
+        b->used = off + sz;
+        return (char*)(b + 1) + off;
+    }
+    size_t used() const {
+        size_t u = 0;
+        for (const Block* b = head; b; b = b->next) u += b->used;
+        return u;
+    }
+    template<typename T> T* alloc_n(size_t n) { return n ? (T*)alloc(n * sizeof(T), alignof(T)) : nullptr; }
+};
+
+struct JStr {
+    const char* p;
+    size_t      n;
+    const char* c_str() const { return p ? p : ""; }
+    bool eq_n(const char* s, size_t l) const {
+        return l == n && (!n || !memcmp(p, s, n));
+    }
+};
+
+static constexpr uint32_t key_hash(const char* s, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; ++i) h = (h ^ (uint8_t)s[i]) * 16777619u;
+    return h;
+}
+
+// Object key with its hash computed up front; constants below are hashed at
+// compile time so hot lookups skip both strlen and hashing.
+struct JKey {
+    const char* s;
+    size_t      n;
+    uint32_t    h;
+    template<size_t N>
+    constexpr JKey(const char (&lit)[N]) : s(lit), n(N - 1), h(key_hash(lit, N - 1)) {}
+    JKey(const char* k, size_t kl) : s(k), n(kl), h(key_hash(k, kl)) {}
+};
+
+inline constexpr JKey JK_LIBRARIES   = "libraries";
+inline constexpr JKey JK_DOWNLOADS   = "downloads";
+inline constexpr JKey JK_ARTIFACT    = "artifact";
+inline constexpr JKey JK_CLASSIFIERS = "classifiers";
+inline constexpr JKey JK_NATIVES     = "natives";
+inline constexpr JKey JK_URL         = "url";
+inline constexpr JKey JK_PATH        = "path";
+inline constexpr JKey JK_HASH        = "hash";
+inline constexpr JKey JK_RULES       = "rules";
+inline constexpr JKey JK_OBJECTS     = "objects";
+inline constexpr JKey JK_FILES       = "files";
+inline constexpr JKey JK_SHA1        = "sha1";
+inline constexpr JKey JK_SIZE        = "size";
+
+// Objects with at least this many members get an open-addressed index of
+// (hash, member) slots built at parse time; smaller ones are scanned.
+inline constexpr size_t JOBJ_HASH_MIN = 16;
+
+struct JSlot { uint32_t h, i; };
+
+static size_t jobj_idx_cap(size_t n) {
+    size_t cap = 32;
+    while (cap < n * 2) cap *= 2;
+    return cap;
+}
+
+// Nodes are 16-byte tagged views owned by the JDoc arena; copying one is a
+// shallow view. A container points at one contiguous block of children: an
+// array's elements, or an object's members as alternating key (string node)
+// and value. A hashed object's slot table sits directly in front of the block.
+struct JVal {
+    enum Type : uint8_t { Null_, Bool_, Num_, Str_, Arr_, Obj_ };
+    Type     type;
+    bool     bval;   // Bool_ value; for Num_, set when ival holds the exact value
+    uint32_t n;      // string length, array elements or object members
+    union {
+        double      nval;
+        int64_t     ival;
+        const char* sval;
+        const JVal* kids;
+    };
 
     bool is_null()   const { return type == Null_; }
     bool is_string() const { return type == Str_; }
     bool is_array()  const { return type == Arr_; }
     bool is_object() const { return type == Obj_; }
-    size_t size()    const { return type == Arr_ ? arr_n : obj_n; }
-    const char* str() const { return sval.c_str(); }
-    double      num() const { return nval; }
+    size_t size()    const { return type == Arr_ || type == Obj_ ? n : 0; }
+    const char* str() const { return type == Str_ ? sval : ""; }
+    double      num() const { return type != Num_ ? 0.0 : bval ? (double)ival : nval; }
+    int64_t     i64() const {
+        if (type != Num_) return 0;
+        if (bval) return ival;
+        return nval > -9.2e18 && nval < 9.2e18 ? (int64_t)nval : 0;
+    }
+    bool    boolean() const { return type == Bool_ && bval; }
+
+    JStr        key(size_t i) const { return JStr{ kids[2 * i].sval, kids[2 * i].n }; }
+    const JVal& val(size_t i) const { return kids[2 * i + 1]; }
+
+    const JVal* find(const JKey& k) const {
+        if (type != Obj_) return nullptr;
+        if (n >= JOBJ_HASH_MIN) {
+            size_t mask = jobj_idx_cap(n) - 1;
+            const JSlot* idx = (const JSlot*)kids - (mask + 1);
+            for (size_t s = k.h & mask; idx[s].i; s = (s + 1) & mask) {
+                const JSlot& sl = idx[s];
+                if (sl.h == k.h && key(sl.i - 1).eq_n(k.s, k.n)) return &val(sl.i - 1);
+            }
+            return nullptr;
+        }
+        for (size_t i = 0; i < n; ++i)
+            if (key(i).eq_n(k.s, k.n)) return &val(i);
+        return nullptr;
+    }
 
-    bool has(const char* k) const {
-        size_t kl = strlen(k);
-        for (size_t i = 0; i < obj_n; ++i)
-            if (obj_keys[i].eq_n(k, kl)) return true;
+    bool has(const JKey& k)   const { return find(k) != nullptr; }
+    bool has(const char* k)   const { return has(JKey(k, strlen(k))); }
+
+    static const JVal& null_ref() { static const JVal nv{}; return nv; }
+
+    const JVal& operator[](const JKey& k) const {
+        const JVal* v = find(k);
+        return v ? *v : null_ref();
+    }
+    const JVal& operator[](const char* k) const { return (*this)[JKey(k, strlen(k))]; }
+    const JVal& operator[](size_t i) const { return type == Arr_ ? kids[i] : null_ref(); }
+};
+static_assert(sizeof(JVal) == 16, "JVal should stay a 16-byte node");
+
+// A whole file mapped copy-on-write. The view can be written to (the JSON
+// builder unescapes strings in place, the binary cache rebases its pointers)
+// without touching the file; only pages actually written get a private copy.
+// Past the end of the file the last page reads as zeros.
+struct MappedFile {
+    HANDLE map;
+    char*  p;
+    size_t n;
+    MappedFile() : map(nullptr), p(nullptr), n(0) {}
+    MappedFile(MappedFile&& o) noexcept : map(o.map), p(o.p), n(o.n) { o.map = nullptr; o.p = nullptr; o.n = 0; }
+    ~MappedFile() { close(); }
+    MappedFile& operator=(MappedFile&& o) noexcept {
+        if (this != &o) {
+            close();
+            map = o.map; p = o.p; n = o.n;
+            o.map = nullptr; o.p = nullptr; o.n = 0;
+        }
+        return *this;
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    // Fails for missing or empty files and for files larger than the address
+    // space allows; callers fall back to reading those.
+    bool open(const WStr& path) {
+        close();
+        HANDLE h = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                               OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (h == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER li{};
+        if (GetFileSizeEx(h, &li) && li.QuadPart > 0 && (unsigned long long)li.QuadPart <= SIZE_MAX)
+            map = CreateFileMappingW(h, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        // The mapping keeps its own reference to the file.
+        CloseHandle(h);
+        if (map) p = (char*)MapViewOfFile(map, FILE_MAP_COPY, 0, 0, 0);
+        if (!p) { close(); return false; }
+        n = (size_t)li.QuadPart;
+        return true;
+    }
+    void close() {
+        if (p) UnmapViewOfFile(p);
+        if (map) CloseHandle(map);
+        map = nullptr; p = nullptr; n = 0;
+    }
+};
+
+// True when the view of an n-byte file ends in zero padding, which then
+// serves as the terminator the text parsers expect after the last byte.
+static bool mapped_has_nul(size_t n) {
+    static const size_t page = [] { SYSTEM_INFO si; GetSystemInfo(&si); return (size_t)si.dwPageSize; }();
+    return n % page != 0;
+}
+
+// A parsed document owns its source text (or its binary cache image), either
+// as a string or as a mapped file; string nodes point straight into it.
+struct JDoc {
+    Str        src;
+    MappedFile map;
+    Arena      arena;
+    JVal       root{};
+};
+
+static double strtod_c(const char* s) {
+    static _locale_t c_loc = _create_locale(LC_NUMERIC, "C");
+    return _strtod_l(s, nullptr, c_loc);
+}
+
+static const double POW10_EXACT[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// Parses the JSON number at p. Integers that fit in int64 are returned exactly
+// through *iv (result true); anything else goes to *dv. Decimal mantissas up
+// to 2^53 with exponents within +-22 are exact in one correctly rounded
+// multiply or divide (Clinger's fast path); the rest use strtod in the C
+// locale, so the user's locale never changes the result.
+static bool parse_json_num(const char* p, int64_t* iv, double* dv) {
+    const char* s = p;
+    bool neg = *p == '-';
+    if (neg) ++p;
+    uint64_t m = 0;
+    int nd = 0, e10 = 0;
+    bool frac = false, trunc = false;
+    for (; *p >= '0' && *p <= '9'; ++p) {
+        if (nd < 19) { m = m * 10 + (uint64_t)(*p - '0'); if (m) ++nd; }
+        else         { ++e10; trunc = true; }
+    }
+    if (*p == '.') {
+        frac = true;
+        for (++p; *p >= '0' && *p <= '9'; ++p) {
+            if (nd < 19) { m = m * 10 + (uint64_t)(*p - '0'); if (m) ++nd; --e10; }
+            else         trunc = true;
+        }
+    }
+    if (*p == 'e' || *p == 'E') {
+        frac = true;
+        bool eneg = false;
+        if (*++p == '-' || *p == '+') eneg = *p++ == '-';
+        int e = 0;
+        for (; *p >= '0' && *p <= '9'; ++p) if (e < 100000) e = e * 10 + (*p - '0');
+        e10 += eneg ? -e : e;
+    }
+    if (!frac && !trunc) {
+        if (!neg && m <= (uint64_t)INT64_MAX)    { *iv = (int64_t)m; return true; }
+        if (neg && m <= (uint64_t)INT64_MAX + 1) { *iv = (int64_t)(0 - m); return true; }
+    }
+    if (!trunc && m <= (1ull << 53) && e10 >= -22 && e10 <= 22) {
+        double d = (double)m;
+        d = e10 < 0 ? d / POW10_EXACT[-e10] : d * POW10_EXACT[e10];
+        *dv = neg ? -d : d;
         return false;
     }
+    *dv = strtod_c(s);
+    return false;
+}
 
-    static JVal& null_ref() { static JVal nv{}; return nv; }
+static JVal make_num(const char* p) {
+    JVal v{}; v.type = JVal::Num_;
+    v.bval = parse_json_num(p, &v.ival, &v.nval);
+    return v;
+}
 
-    const JVal& operator[](const char* k) const {
-        size_t kl = strlen(k);
-        for (size_t i = 0; i < obj_n; ++i)
-            if (obj_keys[i].eq_n(k, kl)) return obj_vals[i];
-        return null_ref();
+// ---- Stage 1: structural index -------------------------------------------
+// The source is classified 64 bytes at a time into bitmasks; escaped quotes
+// and in-string ranges are resolved with carry-propagating bit tricks, and the
+// positions of every quote, bracket, colon, comma and scalar start outside a
+// string are written out in order. The index is built a window at a time as
+// the tree builder consumes it, so it stays in cache and its size does not
+// grow with the document.
+
+struct JBlock { uint64_t quote, bs, ws, op; };
+
+static void jclassify_scalar(const uint8_t* b, JBlock& m) {
+    m = JBlock{};
+    for (int i = 0; i < 64; ++i) {
+        uint64_t bit = 1ull << i;
+        switch (b[i]) {
+            case '"':  m.quote |= bit; break;
+            case '\\': m.bs    |= bit; break;
+            case ' ': case '\t': case '\n': case '\r': m.ws |= bit; break;
+            case '{': case '}': case '[': case ']': case ':': case ',': m.op |= bit; break;
+        }
     }
-    JVal& operator[](const char* k) {
-        size_t kl = strlen(k);
-        for (size_t i = 0; i < obj_n; ++i)
-            if (obj_keys[i].eq_n(k, kl)) return obj_vals[i];
-        if (obj_n >= obj_cap) {
-            size_t nc = obj_cap ? obj_cap * 2 : 4;
-            obj_keys = (Str*)  realloc(obj_keys, nc * sizeof(Str));
-            obj_vals = (JVal*) realloc(obj_vals, nc * sizeof(JVal));
-            for (size_t i = obj_cap; i < nc; ++i) {
-                new (&obj_keys[i]) Str();
-                new (&obj_vals[i]) JVal();
-            }
-            obj_cap = nc;
-        }
-        obj_keys[obj_n].append(k, kl);
-        return obj_vals[obj_n++];
-    }
-    const JVal& operator[](size_t i) const { return arr[i]; }
-    JVal&       operator[](size_t i)       { return arr[i]; }
-
-    void push_arr_val(JVal v) {
-        if (arr_n >= arr_cap) {
-            size_t nc = arr_cap ? arr_cap * 2 : 4;
-            arr = (JVal*)realloc(arr, nc * sizeof(JVal));
-            for (size_t i = arr_cap; i < nc; ++i) new (&arr[i]) JVal();
-            arr_cap = nc;
-        }
-        arr[arr_n++] = std::move(v);
-    }
-    void push_obj_kv(Str k, JVal v) {
-        if (obj_n >= obj_cap) {
-            size_t nc = obj_cap ? obj_cap * 2 : 4;
-            obj_keys = (Str*)  realloc(obj_keys, nc * sizeof(Str));
-            obj_vals = (JVal*) realloc(obj_vals, nc * sizeof(JVal));
-            for (size_t i = obj_cap; i < nc; ++i) {
-                new (&obj_keys[i]) Str();
-                new (&obj_vals[i]) JVal();
-            }
-            obj_cap = nc;
+}
+
+#ifdef GOONMC_SSE2
+static void jclassify_sse2(const uint8_t* b, JBlock& m) {
+    const __m128i q = _mm_set1_epi8('"'),  bs = _mm_set1_epi8('\\');
+    const __m128i sp = _mm_set1_epi8(' '), tb = _mm_set1_epi8('\t');
+    const __m128i lf = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+    const __m128i lc = _mm_set1_epi8(0x20);
+    const __m128i ob = _mm_set1_epi8('{'), cb = _mm_set1_epi8('}');
+    const __m128i co = _mm_set1_epi8(':'), cm = _mm_set1_epi8(',');
+    m = JBlock{};
+    for (int i = 0; i < 4; ++i) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(b + 16 * i));
+        __m128i l = _mm_or_si128(v, lc);    // folds '[' / ']' onto '{' / '}'
+        int sh = 16 * i;
+        m.quote |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, q))  << sh;
+        m.bs    |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, bs)) << sh;
+        __m128i w = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(v, tb)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+        __m128i o = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(l, ob), _mm_cmpeq_epi8(l, cb)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(v, co), _mm_cmpeq_epi8(v, cm)));
+        m.ws |= (uint64_t)(uint32_t)_mm_movemask_epi8(w) << sh;
+        m.op |= (uint64_t)(uint32_t)_mm_movemask_epi8(o) << sh;
+    }
+}
+
+GOONMC_TARGET("avx2")
+static void jclassify_avx2(const uint8_t* b, JBlock& m) {
+    const __m256i q = _mm256_set1_epi8('"'),  bs = _mm256_set1_epi8('\\');
+    const __m256i sp = _mm256_set1_epi8(' '), tb = _mm256_set1_epi8('\t');
+    const __m256i lf = _mm256_set1_epi8('\n'), cr = _mm256_set1_epi8('\r');
+    const __m256i lc = _mm256_set1_epi8(0x20);
+    const __m256i ob = _mm256_set1_epi8('{'), cb = _mm256_set1_epi8('}');
+    const __m256i co = _mm256_set1_epi8(':'), cm = _mm256_set1_epi8(',');
+    m = JBlock{};
+    for (int i = 0; i < 2; ++i) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(b + 32 * i));
+        __m256i l = _mm256_or_si256(v, lc);
+        int sh = 32 * i;
+        m.quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, q))  << sh;
+        m.bs    |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, bs)) << sh;
+        __m256i w = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, sp), _mm256_cmpeq_epi8(v, tb)),
+                                    _mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, cr)));
+        __m256i o = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(l, ob), _mm256_cmpeq_epi8(l, cb)),
+                                    _mm256_or_si256(_mm256_cmpeq_epi8(v, co), _mm256_cmpeq_epi8(v, cm)));
+        m.ws |= (uint64_t)(uint32_t)_mm256_movemask_epi8(w) << sh;
+        m.op |= (uint64_t)(uint32_t)_mm256_movemask_epi8(o) << sh;
+    }
+}
+#endif
+
+static inline uint64_t prefix_xor(uint64_t x) {
+    x ^= x << 1;  x ^= x << 2;  x ^= x << 4;
+    x ^= x << 8;  x ^= x << 16; x ^= x << 32;
+    return x;
+}
+
+struct JScan {
+    uint64_t  prev_escaped, prev_in_str, prev_scalar;
+    uint32_t* out;
+
+    void step(const JBlock& m, uint32_t base) {
+        // Backslash runs: a character is escaped when it follows an odd-length
+        // run. Subtracting run starts from the odd-bit mask flips parity per run.
+        const uint64_t ODD = 0xAAAAAAAAAAAAAAAAull;
+        uint64_t pot     = m.bs & ~prev_escaped;
+        uint64_t code    = (((pot << 1) | ODD) - pot) ^ ODD;
+        uint64_t escaped = code ^ (m.bs | prev_escaped);
+        prev_escaped     = (code & m.bs) >> 63;
+
+        uint64_t quote  = m.quote & ~escaped;
+        uint64_t in_str = prefix_xor(quote) ^ prev_in_str;
+        prev_in_str     = (uint64_t)((int64_t)in_str >> 63);
+
+        uint64_t scalar  = ~(m.op | m.ws | quote);
+        uint64_t follows = (scalar << 1) | prev_scalar;
+        prev_scalar      = scalar >> 63;
+
+        uint64_t st = ((m.op | (scalar & ~follows)) & ~in_str) | quote;
+        while (st) { *out++ = base + (uint32_t)ctz64(st); st &= st - 1; }
+    }
+};
+
+template <void (*classify)(const uint8_t*, JBlock&)>
+static inline size_t json_index_with(JScan& sc, const char* src, size_t i, size_t end, uint32_t* out) {
+    sc.out = out;
+    JBlock m;
+    for (; i + 64 <= end; i += 64) {
+        classify((const uint8_t*)src + i, m);
+        sc.step(m, (uint32_t)i);
+    }
+    if (i < end) {
+        uint8_t tail[64];
+        memset(tail, ' ', sizeof(tail));
+        memcpy(tail, src + i, end - i);
+        classify(tail, m);
+        sc.step(m, (uint32_t)i);
+    }
+    return (size_t)(sc.out - out);
+}
+
+using JIndexFn = size_t (*)(JScan&, const char*, size_t, size_t, uint32_t*);
+
+#ifdef GOONMC_SSE2
+// Each ISA gets its own copy of the loop so the classifier is inlined.
+GOONMC_TARGET("avx2")
+static size_t json_index_avx2(JScan& sc, const char* src, size_t i, size_t end, uint32_t* out) {
+    return json_index_with<jclassify_avx2>(sc, src, i, end, out);
+}
+static size_t json_index_sse2(JScan& sc, const char* src, size_t i, size_t end, uint32_t* out) {
+    return json_index_with<jclassify_sse2>(sc, src, i, end, out);
+}
+#else
+static size_t json_index_scalar(JScan& sc, const char* src, size_t i, size_t end, uint32_t* out) {
+    return json_index_with<jclassify_scalar>(sc, src, i, end, out);
+}
+#endif
+
+// Writes the structural positions in src[i, end) into out and returns the
+// count, which is at most end - i. i is a multiple of 64 and so is end unless
+// it is the end of the source; sc carries the scan state between calls.
+static size_t json_index(JScan& sc, const char* src, size_t i, size_t end, uint32_t* out) {
+#ifdef GOONMC_SSE2
+    static const JIndexFn fn = cpu_has_avx2() ? json_index_avx2 : json_index_sse2;
+#else
+    static const JIndexFn fn = json_index_scalar;
+#endif
+    return fn(sc, src, i, end, out);
+}
+
+// ---- Stage 2: tree builder -----------------------------------------------
+
+inline constexpr size_t JINDEX_WINDOW = 4096;
+
+// Children are collected on a shared scratch stack and copied into the arena
+// once their final count is known, so no per-node realloc happens. The tree
+// is built by walking the structural index produced by json_index(); idx
+// holds entries [kb, n) of it and k is the next one to consume.
+struct JParser {
+    Arena*    arena;
+    Vec<JVal> vals;
+    char*     src;
+    size_t    len;
+    JScan     scan;
+    size_t    scanned;
+    size_t    kb, n, k;
+    double    index_ms;
+    uint32_t  idx[JINDEX_WINDOW];
+
+    JParser(Arena* a, char* s, size_t l)
+        : arena(a), src(s), len(l), scan{}, scanned(0), kb(0), n(0), k(0), index_ms(0) {}
+
+    // Entries are only ever read at k, so a window is replaced once k
+    // passes its end.
+    bool refill() {
+#ifdef GOONMC_PROFILE
+        double t0 = now_ms();
+#endif
+        while (k >= n && scanned < len) {
+            size_t end = len - scanned > JINDEX_WINDOW ? scanned + JINDEX_WINDOW : len;
+            kb = n;
+            n += json_index(scan, src, scanned, end, idx);
+            scanned = end;
         }
-        obj_keys[obj_n] = std::move(k);
-        obj_vals[obj_n] = std::move(v);
-        ++obj_n;
+#ifdef GOONMC_PROFILE
+        index_ms += now_ms() - t0;
+#endif
+        return k < n;
     }
+    uint32_t at(size_t i) const { return idx[i - kb]; }
+    char peek() { return k < n || refill() ? src[at(k)] : 0; }
 };
 
-static inline void skip_ws(const char*& p) {
-    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') ++p;
-}
-
-static Str parse_str_tok(const char*& p) {
-    ++p;
-    Str s{};
-    while (*p && *p != '"') {
-        if (*p == '\\') {
-            ++p;
-            switch (*p) {
-                case '"':  s.append_c('"');  break;
-                case '\\': s.append_c('\\'); break;
-                case '/':  s.append_c('/');  break;
-                case 'n':  s.append_c('\n'); break;
-                case 'r':  s.append_c('\r'); break;
-                case 't':  s.append_c('\t'); break;
-                default:   s.append_c('\\'); s.append_c(*p); break;
+static int hex4(const char* p) {
+    int v = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c = p[i];
+        if      (c >= '0' && c <= '9') v = v * 16 + (c - '0');
+        else if (c >= 'a' && c <= 'f') v = v * 16 + (c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') v = v * 16 + (c - 'A' + 10);
+        else return -1;
+    }
+    return v;
+}
+
+static size_t put_utf8(char* o, uint32_t cp) {
+    if (cp < 0x80)    { o[0] = (char)cp; return 1; }
+    if (cp < 0x800)   { o[0] = (char)(0xC0 | (cp >> 6));  o[1] = (char)(0x80 | (cp & 0x3F)); return 2; }
+    if (cp < 0x10000) { o[0] = (char)(0xE0 | (cp >> 12)); o[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+                        o[2] = (char)(0x80 | (cp & 0x3F)); return 3; }
+    o[0] = (char)(0xF0 | (cp >> 18));         o[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    o[2] = (char)(0x80 | ((cp >> 6) & 0x3F)); o[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// Strings are parsed in place: the closing quote becomes the terminator and the
+// value is a view into the document's source buffer. Only strings that contain
+// a backslash are rewritten, and unescaping never makes them longer.
+static JStr unescape_in_place(char* s, char* e) {
+    char* p = (char*)memchr(s, '\\', (size_t)(e - s));
+    if (!p) { *e = 0; return JStr{ s, (size_t)(e - s) }; }
+    char* o = p;
+    while (p < e) {
+        if (*p != '\\') { *o++ = *p++; continue; }
+        ++p;
+        switch (*p) {
+            case '"':  *o++ = '"';  break;
+            case '\\': *o++ = '\\'; break;
+            case '/':  *o++ = '/';  break;
+            case 'b':  *o++ = '\b'; break;
+            case 'f':  *o++ = '\f'; break;
+            case 'n':  *o++ = '\n'; break;
+            case 'r':  *o++ = '\r'; break;
+            case 't':  *o++ = '\t'; break;
+            case 'u': {
+                int cp = hex4(p + 1);
+                if (cp < 0) { *o++ = '\\'; *o++ = 'u'; break; }
+                p += 4;
+                if (cp >= 0xD800 && cp < 0xDC00 && p[1] == '\\' && p[2] == 'u') {
+                    int lo = hex4(p + 3);
+                    if (lo >= 0xDC00 && lo < 0xE000) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                        p += 6;
+                    }
+                }
+                o += put_utf8(o, (uint32_t)cp);
+                break;
             }
-        } else {
-            s.append_c(*p);
+            case 0:    *o++ = '\\'; continue;
+            default:   *o++ = '\\'; *o++ = *p; break;
         }
         ++p;
     }
-    if (*p == '"') ++p;
-    return s;
+    *o = 0;
+    return JStr{ s, (size_t)(o - s) };
+}
+
+// The index holds both quotes of every string, so the end is the next entry.
+static JStr jb_str(JParser& ps) {
+    char* s = ps.src + ps.at(ps.k++) + 1;
+    char* e = ps.src + ps.len;
+    if (ps.peek() == '"') e = ps.src + ps.at(ps.k++);
+    return unescape_in_place(s, e);
 }
 
-static JVal parse_val(const char*& p);
+static JVal jb_val(JParser& ps);
 
-static JVal parse_obj(const char*& p) {
+static JVal jb_obj(JParser& ps) {
     JVal v{}; v.type = JVal::Obj_;
-    ++p;
-    for (;;) {
-        skip_ws(p);
-        if (!*p || *p == '}') break;
-        if (*p != '"') break;
-        Str key = parse_str_tok(p);
-        skip_ws(p);
-        if (*p == ':') ++p;
-        JVal val = parse_val(p);
-        v.push_obj_kv(std::move(key), std::move(val));
-        skip_ws(p);
-        if (*p == ',') ++p;
-    }
-    if (*p == '}') ++p;
+    size_t base = ps.vals.n;
+    ++ps.k;
+    while (ps.peek() == '"') {
+        JVal key{}; key.type = JVal::Str_;
+        JStr ks = jb_str(ps);
+        key.sval = ks.p; key.n = (uint32_t)ks.n;
+        ps.vals.push_back(key);
+        if (ps.peek() == ':') ++ps.k;
+        JVal val = jb_val(ps);
+        ps.vals.push_back(val);
+        if (ps.peek() == ',') ++ps.k;
+    }
+    if (ps.peek() == '}') ++ps.k;
+    size_t m   = (ps.vals.n - base) / 2;
+    size_t cap = m >= JOBJ_HASH_MIN ? jobj_idx_cap(m) : 0;
+    v.n = (uint32_t)m;
+    if (m) {
+        JSlot* idx = (JSlot*)ps.arena->alloc(cap * sizeof(JSlot) + 2 * m * sizeof(JVal), alignof(JVal));
+        JVal* kids = (JVal*)(idx + cap);
+        memcpy(kids, ps.vals.p + base, 2 * m * sizeof(JVal));
+        v.kids = kids;
+        if (cap) {
+            memset(idx, 0, cap * sizeof(JSlot));
+            for (size_t i = 0; i < m; ++i) {
+                uint32_t h = key_hash(kids[2 * i].sval, kids[2 * i].n);
+                size_t s = h & (cap - 1);
+                while (idx[s].i) s = (s + 1) & (cap - 1);
+                idx[s] = JSlot{ h, (uint32_t)(i + 1) };
+            }
+        }
+    }
+    ps.vals.n = base;
     return v;
 }
 
-static JVal parse_arr(const char*& p) {
+static JVal jb_arr(JParser& ps) {
     JVal v{}; v.type = JVal::Arr_;
-    ++p;
+    size_t base = ps.vals.n;
+    ++ps.k;
     for (;;) {
-        skip_ws(p);
-        if (!*p || *p == ']') break;
-        v.push_arr_val(parse_val(p));
-        skip_ws(p);
-        if (*p == ',') ++p;
+        char c = ps.peek();
+        if (!c || c == ']') break;
+        size_t k0 = ps.k;
+        JVal e = jb_val(ps);
+        if (ps.k == k0) break;
+        ps.vals.push_back(e);
+        if (ps.peek() == ',') ++ps.k;
+    }
+    if (ps.peek() == ']') ++ps.k;
+    v.n = (uint32_t)(ps.vals.n - base);
+    if (v.n) {
+        JVal* kids = ps.arena->alloc_n<JVal>(v.n);
+        memcpy(kids, ps.vals.p + base, v.n * sizeof(JVal));
+        v.kids = kids;
     }
-    if (*p == ']') ++p;
+    ps.vals.n = base;
     return v;
 }
 
-static JVal parse_val(const char*& p) {
-    skip_ws(p);
-    switch (*p) {
-        case '{': return parse_obj(p);
-        case '[': return parse_arr(p);
-        case '"': { JVal v{}; v.type = JVal::Str_; v.sval = parse_str_tok(p); return v; }
-        case 't': if (!strncmp(p, "true",  4)) { JVal v{}; v.type = JVal::Bool_; v.bval = true;  p += 4; return v; } break;
-        case 'f': if (!strncmp(p, "false", 5)) { JVal v{}; v.type = JVal::Bool_; v.bval = false; p += 5; return v; } break;
-        case 'n': if (!strncmp(p, "null",  4)) { p += 4; return JVal{}; } break;
+static JVal jb_val(JParser& ps) {
+    char c = ps.peek();
+    switch (c) {
+        case '{': return jb_obj(ps);
+        case '[': return jb_arr(ps);
+        case '"': {
+            JStr sv = jb_str(ps);
+            JVal v{}; v.type = JVal::Str_; v.sval = sv.p; v.n = (uint32_t)sv.n;
+            return v;
+        }
+        case 0: case '}': case ']': case ':': case ',': return JVal{};
     }
-    JVal v{}; v.type = JVal::Num_;
-    char* end;
-    v.nval = strtod(p, &end); p = end;
-    return v;
+    char* p = ps.src + ps.at(ps.k++);
+    switch (c) {
+        case 't': if (!strncmp(p, "true",  4)) { JVal v{}; v.type = JVal::Bool_; v.bval = true;  return v; } break;
+        case 'f': if (!strncmp(p, "false", 5)) { JVal v{}; v.type = JVal::Bool_; v.bval = false; return v; } break;
+        case 'n': if (!strncmp(p, "null",  4)) return JVal{}; break;
+    }
+    return make_num(p);
+}
+
+// Builds d's tree from the n bytes at src, which d keeps alive and which must
+// be followed by a NUL.
+static void parse_json_into(JDoc& d, char* src, size_t n) {
+    if (!n || n >= UINT32_MAX) return;
+#ifdef GOONMC_PROFILE
+    double t0 = now_ms();
+    DWORD  f0 = prof_faults();
+#endif
+    // Node storage for typical launcher documents is on the order of the
+    // source size, so one block usually holds the whole tree.
+    if (n > d.arena.min_block) d.arena.min_block = n;
+    JParser* ps = new JParser(&d.arena, src, n);
+    ps->vals.reserve(128);
+    d.root = jb_val(*ps);
+#ifdef GOONMC_PROFILE
+    double t1 = now_ms();
+    fprintf(stderr, "[prof] parse_json: %zu bytes%s in %.3f ms (%.2f GB/s; index %.3f ms, %.2f GB/s, %zu entries), "
+                    "%lu page faults, %zu arena bytes in %zu block(s)\n",
+            n, d.map.p ? " mapped" : "", t1 - t0, (double)n / ((t1 - t0) * 1e6),
+            ps->index_ms, (double)ps->scanned / (ps->index_ms * 1e6), ps->n,
+            (unsigned long)(prof_faults() - f0), d.arena.used(), d.arena.nblocks);
+#endif
+    delete ps;
 }
 
-static JVal parse_json(const Str& src) {
-    const char* p = src.c_str();
-    return parse_val(p);
+static JDoc parse_json(Str&& src) {
+    JDoc d{};
+    d.src = std::move(src);
+    if (d.src.empty()) return d;
+    // Nodes point into src, so it must not sit in the inline buffer that moves
+    // with the JDoc.
+    d.src.grow(Str::SSO_CAP + 1);
+    parse_json_into(d, d.src.data(), d.src.n);
+    return d;
 }
 
+// ---- Streaming reader ------------------------------------------------------
+// Push parser for documents that are only walked once (asset indexes, runtime
+// manifests). Input arrives in arbitrary chunks; only the token currently being
+// read is buffered. Object keys are not reported as events: the most recent key
+// at each depth is kept in key[] so a sink can match on its path instead.
+
+enum JSaxEv : uint8_t { JS_OBJ_BEGIN, JS_OBJ_END, JS_ARR_BEGIN, JS_ARR_END, JS_STR, JS_NUM, JS_BOOL, JS_NULL };
+
+inline constexpr int JSAX_MAX_DEPTH = 16;
+
+struct JSax;
+// Container levels count from 0 at the root. Every event fires with depth equal
+// to the number of enclosing containers, so an object member's key is always
+// key[depth - 1], for scalar values and begin/end events alike. String and
+// literal text in s is NUL-terminated.
+using JSaxFn = void (*)(void* ctx, JSax& sx, JSaxEv ev, const char* s, size_t n);
+
+struct JSax {
+    JSaxFn fn;
+    void*  ctx;
+    int    depth;
+    char   kind[JSAX_MAX_DEPTH];
+    Str    key[JSAX_MAX_DEPTH];
+    Str    tok;
+    uint8_t st;         // 0 between tokens, 1 in a string, 2 in a bare literal
+    bool   want_key, tok_esc, esc;
+
+    JSax(JSaxFn f, void* c) : fn(f), ctx(c), depth(0), kind{}, st(0), want_key(false), tok_esc(false), esc(false) {}
+
+    bool key_is(int level, const char* k) const {
+        return level < depth && level < JSAX_MAX_DEPTH && key[level].eq(k);
+    }
+
+    void emit(JSaxEv ev, const char* s = "", size_t n = 0) { fn(ctx, *this, ev, s, n); }
+
+    void open(JSaxEv ev, char k) {
+        emit(ev);
+        if (depth < JSAX_MAX_DEPTH) { kind[depth] = k; key[depth].clear(); }
+        ++depth;
+        want_key = (k == 'o');
+    }
+    void close(JSaxEv ev) {
+        if (depth) --depth;
+        want_key = false;
+        emit(ev);
+    }
+    void end_str() {
+        const char* s = tok.c_str();
+        size_t n = tok.n;
+        if (tok_esc) n = unescape_in_place(tok.data(), tok.data() + tok.n).n;
+        if (want_key) {
+            if (depth && depth <= JSAX_MAX_DEPTH) key[depth - 1].assign(s, n);
+            want_key = false;
+        } else {
+            emit(JS_STR, s, n);
+        }
+    }
+    void end_lit() {
+        const char* s = tok.c_str();
+        if      (tok.eq("true") || tok.eq("false")) emit(JS_BOOL, s, tok.n);
+        else if (tok.eq("null"))                    emit(JS_NULL, s, tok.n);
+        else                                        emit(JS_NUM,  s, tok.n);
+    }
+
+    void feed(const char* p, size_t n) {
+        const char* e = p + n;
+        while (p < e) {
+            if (st == 1) {
+                if (esc) { tok.append_c(*p++); esc = false; continue; }
+                const char* q = p;
+                while (q < e && *q != '"' && *q != '\\') ++q;
+                tok.append(p, (size_t)(q - p));
+                p = q;
+                if (p == e) break;
+                if (*p == '\\') { tok.append_c('\\'); tok_esc = esc = true; ++p; continue; }
+                ++p; st = 0;
+                end_str();
+                continue;
+            }
+            if (st == 2) {
+                const char* q = p;
+                while (q < e && !strchr(" \t\r\n,:]}", *q)) ++q;
+                tok.append(p, (size_t)(q - p));
+                p = q;
+                if (p == e) break;
+                st = 0;
+                end_lit();
+                continue;
+            }
+            char c = *p++;
+            switch (c) {
+                case ' ': case '\t': case '\r': case '\n': break;
+                case '{': open(JS_OBJ_BEGIN, 'o'); break;
+                case '[': open(JS_ARR_BEGIN, 'a'); break;
+                case '}': close(JS_OBJ_END); break;
+                case ']': close(JS_ARR_END); break;
+                case ':': want_key = false; break;
+                case ',': want_key = depth && depth <= JSAX_MAX_DEPTH && kind[depth - 1] == 'o'; break;
+                case '"': st = 1; tok.clear(); tok_esc = false; break;
+                default:  st = 2; tok.n = 0; tok.append_c(c); break;
+            }
+        }
+    }
+    void finish() {
+        if (st == 2) end_lit();
+        st = 0;
+    }
+};
+
 static WStr to_wide_str(const char* s, int len = -1) {
     WStr r{};
     if (!s || !*s) return r;
     int n = MultiByteToWideChar(CP_UTF8, 0, s, len, nullptr, 0);
     if (n <= 0) return r;
     r.grow((size_t)n);
-    MultiByteToWideChar(CP_UTF8, 0, s, len, r.p, n);
+    MultiByteToWideChar(CP_UTF8, 0, s, len, r.data(), n);
     r.n = (size_t)(len == -1 ? n - 1 : n);
-    if (r.p) r.p[r.n] = 0;
+    r.data()[r.n] = 0;
     return r;
 }
 
@@ -386,9 +1097,9 @@ static Str to_utf8_str(const wchar_t* w, int len = -1) {
     int n = WideCharToMultiByte(CP_UTF8, 0, w, len, nullptr, 0, nullptr, nullptr);
     if (n <= 0) return r;
     r.grow((size_t)n);
-    WideCharToMultiByte(CP_UTF8, 0, w, len, r.p, n, nullptr, nullptr);
+    WideCharToMultiByte(CP_UTF8, 0, w, len, r.data(), n, nullptr, nullptr);
     r.n = (size_t)(len == -1 ? n - 1 : n);
-    if (r.p) r.p[r.n] = 0;
+    r.data()[r.n] = 0;
     return r;
 }
 
@@ -396,10 +1107,72 @@ static WStr pjoin(const WStr& base, const char* comp) {
     WStr r{}; r.copy_from(base);
     if (r.n && r.back() != L'\\') r.append_c(L'\\');
     WStr w = to_wide_str(comp);
-    if (w.p) r.append(w.p, w.n);
+    r.append(w.data(), w.n);
     return r;
 }
 
+// Path builder for hot loops: components are joined like pjoin, but UTF-8 is
+// converted straight into a stack buffer (spilling to the heap only for very
+// long paths). Take mark() after the shared prefix and reset() to it to reuse
+// the prefix for the next entry.
+struct PathBuf {
+    static constexpr size_t INLINE = 512;
+    wchar_t  sbuf[INLINE];
+    wchar_t* p;
+    size_t   n, cap;
+
+    PathBuf() : p(sbuf), n(0), cap(INLINE - 1) { sbuf[0] = 0; }
+    explicit PathBuf(const WStr& base) : PathBuf() { append_w(base.c_str(), base.n); }
+    ~PathBuf() { if (p != sbuf) free(p); }
+    PathBuf(const PathBuf&) = delete;
+    PathBuf& operator=(const PathBuf&) = delete;
+
+    void reserve(size_t extra) {
+        if (n + extra <= cap) return;
+        size_t nc = cap * 2;
+        if (nc < n + extra) nc = n + extra;
+        if (p == sbuf) {
+            wchar_t* h = (wchar_t*)malloc((nc + 1) * sizeof(wchar_t));
+            memcpy(h, sbuf, (n + 1) * sizeof(wchar_t));
+            p = h;
+        } else {
+            p = (wchar_t*)realloc(p, (nc + 1) * sizeof(wchar_t));
+        }
+        cap = nc;
+    }
+    size_t mark() const      { return n; }
+    void   reset(size_t m)   { n = m; p[n] = 0; }
+    const wchar_t* c_str() const { return p; }
+
+    // UTF-16 never needs more units than the UTF-8 input has bytes.
+    PathBuf& append(const char* s, size_t len) {
+        reserve(len);
+        size_t i = 0;
+        for (; i < len && (uint8_t)s[i] < 0x80; ++i) p[n++] = (wchar_t)s[i];
+        if (i < len)
+            n += (size_t)MultiByteToWideChar(CP_UTF8, 0, s + i, (int)(len - i), p + n, (int)(cap - n));
+        p[n] = 0;
+        return *this;
+    }
+    PathBuf& append(const char* s) { return s ? append(s, strlen(s)) : *this; }
+    PathBuf& append_w(const wchar_t* s, size_t len) {
+        reserve(len);
+        memcpy(p + n, s, len * sizeof(wchar_t));
+        n += len; p[n] = 0;
+        return *this;
+    }
+    PathBuf& append_w(const wchar_t* s) { return s ? append_w(s, wcslen(s)) : *this; }
+    PathBuf& sep() {
+        if (n && p[n - 1] != L'\\') { reserve(1); p[n++] = L'\\'; p[n] = 0; }
+        return *this;
+    }
+    PathBuf& add(const char* comp)      { return sep().append(comp); }
+    PathBuf& add_w(const wchar_t* comp) { return sep().append_w(comp); }
+
+    WStr wstr() const { WStr r{}; r.append(p, n); return r; }
+    Str  utf8() const { return n ? to_utf8_str(p, (int)n) : Str{}; }
+};
+
 static WStr pjoin_w(const WStr& base, const wchar_t* comp) {
     WStr r{}; r.copy_from(base);
     if (r.n && r.back() != L'\\') r.append_c(L'\\');
@@ -415,13 +1188,15 @@ static bool path_exists_w(const wchar_t* path) {
     return GetFileAttributesW(path) != INVALID_FILE_ATTRIBUTES;
 }
 
-static LONGLONG path_file_size(const WStr& path) {
+static LONGLONG path_file_size_w(const wchar_t* path) {
     WIN32_FILE_ATTRIBUTE_DATA d;
-    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &d)) return -1;
+    if (!GetFileAttributesExW(path, GetFileExInfoStandard, &d)) return -1;
     LARGE_INTEGER li; li.HighPart = (LONG)d.nFileSizeHigh; li.LowPart = d.nFileSizeLow;
     return li.QuadPart;
 }
 
+static LONGLONG path_file_size(const WStr& path) { return path_file_size_w(path.c_str()); }
+
 static bool path_is_dir(const WStr& path) {
     DWORD a = GetFileAttributesW(path.c_str());
     return a != INVALID_FILE_ATTRIBUTES && (a & FILE_ATTRIBUTE_DIRECTORY);
@@ -439,253 +1214,1788 @@ static WStr path_parent(const WStr& path) {
     return r;
 }
 
-static void create_dirs(const WStr& path) {
-    size_t len = path.n;
-    wchar_t* tmp = (wchar_t*)malloc((len + 2) * sizeof(wchar_t));
-    memcpy(tmp, path.p, (len + 1) * sizeof(wchar_t));
-    for (size_t i = 1; i <= len; ++i) {
-        if (i == len || tmp[i] == L'\\' || tmp[i] == L'/') {
-            wchar_t c = tmp[i]; tmp[i] = 0;
-            CreateDirectoryW(tmp, nullptr);
-            tmp[i] = c;
+// Directories this process has created or found to exist, as 64-bit hashes
+// of their paths in an open-addressed table that threads insert into with a
+// compare-and-swap, so creating a file's directory is usually no syscall and
+// never a lock. The set is only a hint: when it fills up, new directories go
+// uncached, and a directory removed behind the process's back stays cached.
+inline constexpr size_t DIR_CACHE_SLOTS = 16384;  // power of two
+inline volatile LONG64 g_dir_cache[DIR_CACHE_SLOTS];
+
+static uint64_t dir_hash(const wchar_t* p, size_t n) {
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < n; ++i) {
+        wchar_t c = p[i] == L'/' ? L'\\' : p[i];
+        h = (h ^ (uint16_t)c) * 1099511628211ull;
+    }
+    return h ? h : 1;  // 0 marks a free slot
+}
+
+// Probes at most this many slots before giving up on a lookup or insert.
+inline constexpr size_t DIR_CACHE_PROBES = 64;
+
+static bool dir_cache_has(uint64_t h) {
+    for (size_t i = 0; i < DIR_CACHE_PROBES; ++i) {
+        LONG64 v = g_dir_cache[(h + i) & (DIR_CACHE_SLOTS - 1)];
+        if (v == (LONG64)h) return true;
+        if (!v) return false;
+    }
+    return false;
+}
+
+static void dir_cache_add(uint64_t h) {
+    for (size_t i = 0; i < DIR_CACHE_PROBES; ++i) {
+        volatile LONG64* slot = &g_dir_cache[(h + i) & (DIR_CACHE_SLOTS - 1)];
+        LONG64 v = *slot;
+        if (!v) v = InterlockedCompareExchange64(slot, (LONG64)h, 0);
+        if (!v || v == (LONG64)h) return;
+    }
+}
+
+// Creates the directory p[0..n) and any missing ancestors. p[n] is written
+// to (and restored) to terminate each prefix in place.
+static bool dir_create(wchar_t* p, size_t n) {
+    uint64_t h = dir_hash(p, n);
+    if (dir_cache_has(h)) return true;
+    wchar_t c = p[n];
+    p[n] = 0;
+    bool ok = CreateDirectoryW(p, nullptr) != 0;
+    DWORD err = ok ? 0 : GetLastError();
+    if (err == ERROR_PATH_NOT_FOUND) {
+        size_t k = n;
+        while (k && p[k - 1] != L'\\' && p[k - 1] != L'/') --k;
+        if (k > 1 && dir_create(p, k - 1)) {
+            ok  = CreateDirectoryW(p, nullptr) != 0;
+            err = ok ? 0 : GetLastError();
+        }
+    }
+    if (!ok) {
+        // Drive and share roots refuse creation with other errors.
+        DWORD a = GetFileAttributesW(p);
+        ok = err == ERROR_ALREADY_EXISTS ||
+             (a != INVALID_FILE_ATTRIBUTES && (a & FILE_ATTRIBUTE_DIRECTORY));
+    }
+    p[n] = c;
+    if (ok) dir_cache_add(h);
+    return ok;
+}
+
+// Creates the directory named by the first n characters of path.
+static void create_dirs_n(const WStr& path, size_t n) {
+    while (n && (path.data()[n - 1] == L'\\' || path.data()[n - 1] == L'/')) --n;
+    if (!n) return;
+    wchar_t sbuf[512];
+    wchar_t* tmp = n < 512 ? sbuf : (wchar_t*)malloc((n + 1) * sizeof(wchar_t));
+    memcpy(tmp, path.data(), n * sizeof(wchar_t));
+    tmp[n] = 0;
+    dir_create(tmp, n);
+    if (tmp != sbuf) free(tmp);
+}
+
+static void create_dirs(const WStr& path) { create_dirs_n(path, path.n); }
+
+static Str read_file(const WStr& path) {
+    Str r{};
+    HANDLE h = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                           OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return r;
+    LARGE_INTEGER li{};
+    if (GetFileSizeEx(h, &li) && li.QuadPart > 0 && (unsigned long long)li.QuadPart < SIZE_MAX) {
+        size_t sz = (size_t)li.QuadPart;
+        r.grow(sz);
+        // ReadFile takes a 32-bit count, so large files are read in pieces.
+        while (r.n < sz) {
+            size_t want = sz - r.n;
+            DWORD rd = 0;
+            if (want > ((size_t)1 << 30)) want = (size_t)1 << 30;
+            if (!ReadFile(h, r.data() + r.n, (DWORD)want, &rd, nullptr) || !rd) break;
+            r.n += rd;
+        }
+        r.data()[r.n] = 0;
+    }
+    CloseHandle(h);
+    return r;
+}
+
+// Receives successive pieces of a body or file; returning false stops the read.
+using ChunkFn = bool (*)(void* ctx, const char* p, size_t n);
+
+// The file is handed over as one piece from a mapped view when it can be
+// mapped, otherwise in 64 KB reads.
+static bool read_file_stream(const WStr& path, ChunkFn sink, void* ctx) {
+    MappedFile mf;
+    if (mf.open(path)) return sink(ctx, mf.p, mf.n);
+    HANDLE h = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                           OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    bool ok = true;
+    char buf[65536];
+    DWORD rd = 0;
+    while (ReadFile(h, buf, sizeof(buf), &rd, nullptr) && rd)
+        if (!sink(ctx, buf, (size_t)rd)) { ok = false; break; }
+    CloseHandle(h);
+    return ok;
+}
+
+// Parses the file at path straight from a mapped view. Files whose size is a
+// whole number of pages have no zero padding to end the text on and are read
+// into memory instead, as are files that cannot be mapped. Documents too
+// large for the parser are turned down without reading them.
+static JDoc parse_json_file(const WStr& path) {
+    JDoc d{};
+    if (d.map.open(path) && (mapped_has_nul(d.map.n) || d.map.n >= UINT32_MAX)) {
+        parse_json_into(d, d.map.p, d.map.n);
+        return d;
+    }
+    d.map.close();
+    return parse_json(read_file(path));
+}
+
+static bool write_file(const WStr& path, const char* data, size_t len) {
+    HANDLE h = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr,
+                           CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    DWORD wr = 0;
+    BOOL ok = WriteFile(h, data, (DWORD)len, &wr, nullptr);
+    CloseHandle(h);
+    return ok && wr == len;
+}
+
+// ---- SHA-1 -----------------------------------------------------------------
+//
+// Downloads are hashed as they stream in, so the digest is ready when the last
+// byte is written. Block compression uses the SHA extensions where the CPU
+// has them and a plain scalar loop otherwise.
+
+using Sha1BlocksFn = void (*)(uint32_t st[5], const uint8_t* p, size_t nblk);
+
+static inline uint32_t rotl32(uint32_t x, int r) { return (x << r) | (x >> (32 - r)); }
+
+static void sha1_blocks_scalar(uint32_t st[5], const uint8_t* p, size_t nblk) {
+    // Rounds are unrolled five at a time with the variables renamed instead of
+    // shuffled, and the message schedule lives in a 16-word ring.
+#define SHA1_W(i) ((i) < 16 ? w[(i) & 15] :                                     \
+    (w[(i) & 15] = rotl32(w[((i) + 13) & 15] ^ w[((i) + 8) & 15] ^               \
+                          w[((i) + 2) & 15] ^ w[(i) & 15], 1)))
+#define SHA1_R(a, b, c, d, e, f, k, i) \
+    e += rotl32(a, 5) + (f) + k + SHA1_W(i); b = rotl32(b, 30);
+#define SHA1_R5(i, F, k)                                                         \
+    SHA1_R(a, b, c, d, e, F(b, c, d), k, i)                                      \
+    SHA1_R(e, a, b, c, d, F(a, b, c), k, i + 1)                                  \
+    SHA1_R(d, e, a, b, c, F(e, a, b), k, i + 2)                                  \
+    SHA1_R(c, d, e, a, b, F(d, e, a), k, i + 3)                                  \
+    SHA1_R(b, c, d, e, a, F(c, d, e), k, i + 4)
+#define SHA1_CH(x, y, z)  ((z) ^ ((x) & ((y) ^ (z))))
+#define SHA1_PAR(x, y, z) ((x) ^ (y) ^ (z))
+#define SHA1_MAJ(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+    for (; nblk; --nblk, p += 64) {
+        uint32_t w[16];
+        for (int i = 0; i < 16; ++i)
+            w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 |
+                   (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+        uint32_t a = st[0], b = st[1], c = st[2], d = st[3], e = st[4];
+        SHA1_R5( 0, SHA1_CH,  0x5A827999) SHA1_R5( 5, SHA1_CH,  0x5A827999)
+        SHA1_R5(10, SHA1_CH,  0x5A827999) SHA1_R5(15, SHA1_CH,  0x5A827999)
+        SHA1_R5(20, SHA1_PAR, 0x6ED9EBA1) SHA1_R5(25, SHA1_PAR, 0x6ED9EBA1)
+        SHA1_R5(30, SHA1_PAR, 0x6ED9EBA1) SHA1_R5(35, SHA1_PAR, 0x6ED9EBA1)
+        SHA1_R5(40, SHA1_MAJ, 0x8F1BBCDC) SHA1_R5(45, SHA1_MAJ, 0x8F1BBCDC)
+        SHA1_R5(50, SHA1_MAJ, 0x8F1BBCDC) SHA1_R5(55, SHA1_MAJ, 0x8F1BBCDC)
+        SHA1_R5(60, SHA1_PAR, 0xCA62C1D6) SHA1_R5(65, SHA1_PAR, 0xCA62C1D6)
+        SHA1_R5(70, SHA1_PAR, 0xCA62C1D6) SHA1_R5(75, SHA1_PAR, 0xCA62C1D6)
+        st[0] += a; st[1] += b; st[2] += c; st[3] += d; st[4] += e;
+    }
+#undef SHA1_W
+#undef SHA1_R
+#undef SHA1_R5
+#undef SHA1_CH
+#undef SHA1_PAR
+#undef SHA1_MAJ
+}
+
+#ifdef GOONMC_SSE2
+// One group of four rounds once the message schedule is running: E advances
+// from the previous group, ABCD is saved as the next group's E, and the three
+// later message words each take their share of MJ.
+#define SHA1NI_STEP(EC, EO, MJ, MJ1, MJ2, MJ3, F)          \
+    EC   = _mm_sha1nexte_epu32(EC, MJ);                  \
+    EO   = abcd;                                         \
+    MJ1  = _mm_sha1msg2_epu32(MJ1, MJ);                  \
+    abcd = _mm_sha1rnds4_epu32(abcd, EC, F);             \
+    MJ3  = _mm_sha1msg1_epu32(MJ3, MJ);                  \
+    MJ2  = _mm_xor_si128(MJ2, MJ);
+
+GOONMC_TARGET("sha,sse4.1")
+static void sha1_blocks_ni(uint32_t st[5], const uint8_t* p, size_t nblk) {
+    const __m128i bswap = _mm_set_epi64x(0x0001020304050607LL, 0x08090a0b0c0d0e0fLL);
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)st), 0x1B);
+    __m128i e0   = _mm_set_epi32((int)st[4], 0, 0, 0), e1;
+    for (; nblk; --nblk, p += 64) {
+        __m128i abcd_save = abcd, e0_save = e0;
+        __m128i m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p +  0)), bswap);
+        __m128i m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + 16)), bswap);
+        __m128i m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + 32)), bswap);
+        __m128i m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + 48)), bswap);
+
+        e0   = _mm_add_epi32(e0, m0);                       // rounds 0-3
+        e1   = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        e1   = _mm_sha1nexte_epu32(e1, m1);                 // 4-7
+        e0   = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        m0   = _mm_sha1msg1_epu32(m0, m1);
+        e0   = _mm_sha1nexte_epu32(e0, m2);                 // 8-11
+        e1   = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        m1   = _mm_sha1msg1_epu32(m1, m2);
+        m0   = _mm_xor_si128(m0, m2);
+
+        SHA1NI_STEP(e1, e0, m3, m0, m1, m2, 0)              // 12-15
+        SHA1NI_STEP(e0, e1, m0, m1, m2, m3, 0)              // 16-19
+        SHA1NI_STEP(e1, e0, m1, m2, m3, m0, 1)
+        SHA1NI_STEP(e0, e1, m2, m3, m0, m1, 1)
+        SHA1NI_STEP(e1, e0, m3, m0, m1, m2, 1)
+        SHA1NI_STEP(e0, e1, m0, m1, m2, m3, 1)
+        SHA1NI_STEP(e1, e0, m1, m2, m3, m0, 1)              // 36-39
+        SHA1NI_STEP(e0, e1, m2, m3, m0, m1, 2)
+        SHA1NI_STEP(e1, e0, m3, m0, m1, m2, 2)
+        SHA1NI_STEP(e0, e1, m0, m1, m2, m3, 2)
+        SHA1NI_STEP(e1, e0, m1, m2, m3, m0, 2)
+        SHA1NI_STEP(e0, e1, m2, m3, m0, m1, 2)              // 56-59
+        SHA1NI_STEP(e1, e0, m3, m0, m1, m2, 3)
+        SHA1NI_STEP(e0, e1, m0, m1, m2, m3, 3)              // 64-67
+
+        e1   = _mm_sha1nexte_epu32(e1, m1);                 // 68-71
+        e0   = abcd;
+        m2   = _mm_sha1msg2_epu32(m2, m1);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+        m3   = _mm_xor_si128(m3, m1);
+        e0   = _mm_sha1nexte_epu32(e0, m2);                 // 72-75
+        e1   = abcd;
+        m3   = _mm_sha1msg2_epu32(m3, m2);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+        e1   = _mm_sha1nexte_epu32(e1, m3);                 // 76-79
+        e0   = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+        e0   = _mm_sha1nexte_epu32(e0, e0_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+    _mm_storeu_si128((__m128i*)st, _mm_shuffle_epi32(abcd, 0x1B));
+    st[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+}
+#undef SHA1NI_STEP
+#endif
+
+static Sha1BlocksFn pick_sha1_blocks() {
+#ifdef GOONMC_SSE2
+    if (cpu_has_sha()) return sha1_blocks_ni;
+#endif
+    return sha1_blocks_scalar;
+}
+
+struct Sha1 {
+    uint32_t st[5];
+    uint8_t  buf[64];
+    uint64_t len;
+
+    Sha1() { reset(); }
+    void reset() {
+        st[0] = 0x67452301; st[1] = 0xEFCDAB89; st[2] = 0x98BADCFE;
+        st[3] = 0x10325476; st[4] = 0xC3D2E1F0;
+        len = 0;
+    }
+    void update(const void* data, size_t n) {
+        static const Sha1BlocksFn blocks = pick_sha1_blocks();
+        const uint8_t* p = (const uint8_t*)data;
+        size_t have = (size_t)(len & 63);
+        len += n;
+        if (have) {
+            size_t take = 64 - have < n ? 64 - have : n;
+            memcpy(buf + have, p, take);
+            p += take; n -= take;
+            if (have + take < 64) return;
+            blocks(st, buf, 1);
         }
+        if (n >= 64) { blocks(st, p, n / 64); p += n & ~(size_t)63; n &= 63; }
+        if (n) memcpy(buf, p, n);
     }
-    free(tmp);
+    void final(uint8_t out[20]) {
+        uint64_t bits = len * 8;
+        static const uint8_t pad[64] = { 0x80 };
+        update(pad, 1 + ((119 - (len & 63)) & 63));
+        uint8_t be[8];
+        for (int i = 0; i < 8; ++i) be[i] = (uint8_t)(bits >> (56 - 8 * i));
+        update(be, 8);
+        for (int i = 0; i < 20; ++i) out[i] = (uint8_t)(st[i / 4] >> (24 - 8 * (i % 4)));
+    }
+};
+
+static bool sha1_feed(void* ctx, const char* p, size_t n) {
+    ((Sha1*)ctx)->update(p, n);
+    return true;
+}
+
+// Compares a digest with a 40-digit hex string, in either case.
+static bool sha1_matches(const uint8_t d[20], const Str& hex) {
+    if (hex.n != 40) return false;
+    const char* h = hex.c_str();
+    for (int i = 0; i < 40; ++i) {
+        int c = tolower((unsigned char)h[i]), v;
+        if      (c >= '0' && c <= '9') v = c - '0';
+        else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+        else return false;
+        if (v != ((d[i / 2] >> (i & 1 ? 0 : 4)) & 15)) return false;
+    }
+    return true;
+}
+
+// ---- Parsed document cache -------------------------------------------------
+
+// <name>.json is cached beside itself as <name>.json.bin: a header followed by
+// the node tree in JVal layout, with every pointer stored as an offset from
+// the start of the file. Loading maps the file and rebases those offsets, so
+// no text is parsed. Entries are keyed on the JSON's size and write time.
+struct JCacheHdr {
+    char     magic[4];
+    uint32_t version;
+    uint64_t src_size, src_mtime;
+    uint64_t total;
+    JVal     root;
+};
+inline constexpr uint32_t JCACHE_VERSION = 1;
+static_assert(sizeof(JCacheHdr) > Str::SSO_CAP, "cache images must never be stored inline");
+
+static bool file_stamp(const WStr& path, uint64_t* size, uint64_t* mtime) {
+    WIN32_FILE_ATTRIBUTE_DATA d;
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &d)) return false;
+    *size  = ((uint64_t)d.nFileSizeHigh << 32) | d.nFileSizeLow;
+    *mtime = ((uint64_t)d.ftLastWriteTime.dwHighDateTime << 32) | d.ftLastWriteTime.dwLowDateTime;
+    return true;
+}
+
+// Appends v's payload to out and returns v with offsets in place of pointers.
+static JVal jc_emit(Str& out, const JVal& v) {
+    JVal r = v;
+    if (v.type == JVal::Str_) {
+        r.sval = (const char*)(uintptr_t)out.n;
+        out.append(v.sval, v.n);
+        out.append_c(0);
+    } else if ((v.type == JVal::Arr_ || v.type == JVal::Obj_) && v.n) {
+        size_t cnt = v.type == JVal::Obj_ ? 2 * (size_t)v.n : v.n;
+        size_t cap = v.type == JVal::Obj_ && v.n >= JOBJ_HASH_MIN ? jobj_idx_cap(v.n) : 0;
+        while (out.n & (alignof(JVal) - 1)) out.append_c(0);
+        size_t at = out.n, bytes = cap * sizeof(JSlot) + cnt * sizeof(JVal);
+        out.grow(bytes);
+        if (cap) memcpy(out.data() + at, (const JSlot*)v.kids - cap, cap * sizeof(JSlot));
+        out.n += bytes;
+        out.data()[out.n] = 0;
+        size_t kids = at + cap * sizeof(JSlot);
+        for (size_t i = 0; i < cnt; ++i) {
+            JVal c = jc_emit(out, v.kids[i]);
+            memcpy(out.data() + kids + i * sizeof(JVal), &c, sizeof(JVal));
+        }
+        r.kids = (const JVal*)(uintptr_t)kids;
+    }
+    return r;
+}
+
+static bool jc_rebase(char* base, size_t len, JVal& v) {
+    switch (v.type) {
+        case JVal::Null_: case JVal::Bool_: case JVal::Num_:
+            return true;
+        case JVal::Str_: {
+            uintptr_t off = (uintptr_t)v.sval;
+            if (off >= len || v.n >= len - off || base[off + v.n]) return false;
+            v.sval = base + off;
+            return true;
+        }
+        case JVal::Arr_: case JVal::Obj_: {
+            if (!v.n) return true;
+            bool obj = v.type == JVal::Obj_;
+            size_t cnt = obj ? 2 * (size_t)v.n : v.n;
+            uintptr_t off = (uintptr_t)v.kids;
+            if ((off & (alignof(JVal) - 1)) || off > len || cnt > (len - off) / sizeof(JVal)) return false;
+            // JVal::find trusts a hashed object's slot table: it has to lie
+            // inside the image, name only real members and keep a free slot
+            // to end each probe.
+            if (obj && v.n >= JOBJ_HASH_MIN) {
+                size_t cap = jobj_idx_cap(v.n);
+                if (off < cap * sizeof(JSlot)) return false;
+                const JSlot* idx = (const JSlot*)(base + off) - cap;
+                size_t nfree = 0;
+                for (size_t s = 0; s < cap; ++s) {
+                    if (!idx[s].i) ++nfree;
+                    else if (idx[s].i > v.n) return false;
+                }
+                if (!nfree) return false;
+            }
+            JVal* kids = (JVal*)(base + off);
+            v.kids = kids;
+            for (size_t i = 0; i < cnt; ++i) {
+                if (obj && !(i & 1) && kids[i].type != JVal::Str_) return false;
+                if (!jc_rebase(base, len, kids[i])) return false;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+// Parses path, or loads its up-to-date binary cache; a stale or missing cache
+// is rewritten after parsing. Returns an empty document if path is missing.
+static JDoc load_json_cached(const WStr& path) {
+#ifdef GOONMC_PROFILE
+    double t0 = now_ms();
+#endif
+    uint64_t sz = 0, mt = 0;
+    if (!file_stamp(path, &sz, &mt)) return JDoc{};
+    WStr cpath{}; cpath.copy_from(path); cpath.append_w(L".bin");
+
+    // The image is rebased in its copy-on-write view; the file stays as it is.
+    JDoc d{};
+    if (d.map.open(cpath) && d.map.n >= sizeof(JCacheHdr)) {
+        const JCacheHdr* h = (const JCacheHdr*)d.map.p;
+        if (!memcmp(h->magic, "GJDC", 4) && h->version == JCACHE_VERSION &&
+            h->src_size == sz && h->src_mtime == mt && h->total == d.map.n) {
+            d.root = h->root;
+            if (jc_rebase(d.map.p, d.map.n, d.root)) {
+#ifdef GOONMC_PROFILE
+                fprintf(stderr, "[prof] %ls: cache hit, %.3f ms\n", path.c_str(), now_ms() - t0);
+#endif
+                return d;
+            }
+        }
+    }
+
+    d = parse_json_file(path);
+    JCacheHdr hdr{};
+    Str out{};
+    out.append((const char*)&hdr, sizeof(hdr));
+    hdr.root = jc_emit(out, d.root);
+    memcpy(hdr.magic, "GJDC", 4);
+    hdr.version   = JCACHE_VERSION;
+    hdr.src_size  = sz;
+    hdr.src_mtime = mt;
+    hdr.total     = out.n;
+    memcpy(out.data(), &hdr, sizeof(hdr));
+    // Written under a private name and moved into place, so another instance
+    // never maps a partial cache. While one still has the old cache mapped
+    // the move fails and the cache is rewritten on a later run.
+    WStr tmp{}; tmp.copy_from(cpath);
+    wchar_t sfx[32];
+    swprintf(sfx, 32, L".%lu.tmp", (unsigned long)GetCurrentProcessId());
+    tmp.append_w(sfx);
+    if (!write_file(tmp, out.data(), out.n) ||
+        !MoveFileExW(tmp.c_str(), cpath.c_str(), MOVEFILE_REPLACE_EXISTING))
+        DeleteFileW(tmp.c_str());
+#ifdef GOONMC_PROFILE
+    fprintf(stderr, "[prof] %ls: parsed and cached, %.3f ms\n", path.c_str(), now_ms() - t0);
+#endif
+    return d;
+}
+
+static Str read_line() {
+    Str r{};
+    int c;
+    while ((c = getchar()) != EOF && c != '\n')
+        r.append_c((char)c);
+    if (!r.empty() && r.back() == '\r') r.pop_back();
+    return r;
+}
+
+static bool parse_int(const Str& s, int* out) {
+    if (s.empty()) return false;
+    size_t start = (s.data()[0] == '-') ? 1 : 0;
+    if (start >= s.n) return false;
+    for (size_t i = start; i < s.n; ++i)
+        if (!isdigit((uint8_t)s.data()[i])) return false;
+    *out = atoi(s.c_str());
+    return true;
+}
+
+static void CALLBACK ax_callback(HINTERNET h, DWORD_PTR ctx, DWORD status, LPVOID info, DWORD len);
+
+inline constexpr int HTTP_RESOLVE_TIMEOUT_MS = 10000;
+inline constexpr int HTTP_CONNECT_TIMEOUT_MS = 10000;
+inline constexpr int HTTP_SEND_TIMEOUT_MS    = 15000;
+inline constexpr int HTTP_RECV_TIMEOUT_MS    = 20000;
+
+// g_sess serves blocking requests; g_asess is the WINHTTP_FLAG_ASYNC session
+// behind the download engine, with every completion routed to ax_callback.
+struct WSession {
+    HINTERNET h = nullptr;
+    explicit WSession(DWORD flags = 0) {
+        h = WinHttpOpen(L"GoonMC/1.0",
+            WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
+            WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, flags);
+        if (h) {
+            DWORD pol = WINHTTP_OPTION_REDIRECT_POLICY_NEVER;
+            WinHttpSetOption(h, WINHTTP_OPTION_REDIRECT_POLICY, &pol, sizeof(pol));
+            // A stalled connection fails after HTTP_RECV_TIMEOUT_MS without
+            // data instead of holding its transfer open indefinitely.
+            WinHttpSetTimeouts(h, HTTP_RESOLVE_TIMEOUT_MS, HTTP_CONNECT_TIMEOUT_MS,
+                               HTTP_SEND_TIMEOUT_MS, HTTP_RECV_TIMEOUT_MS);
+        }
+        if (h && (flags & WINHTTP_FLAG_ASYNC) &&
+            WinHttpSetStatusCallback(h, ax_callback,
+                WINHTTP_CALLBACK_FLAG_ALL_COMPLETIONS | WINHTTP_CALLBACK_FLAG_HANDLES, 0)
+                == WINHTTP_INVALID_STATUS_CALLBACK) {
+            WinHttpCloseHandle(h);
+            h = nullptr;
+        }
+    }
+    ~WSession() { if (h) WinHttpCloseHandle(h); }
+    WSession(const WSession&) = delete;
+    WSession& operator=(const WSession&) = delete;
+} g_sess, g_asess(WINHTTP_FLAG_ASYNC);
+
+struct CrackResult { WStr host, path; INTERNET_PORT port; bool https; };
+
+// WinHttpConnect handles are thread-safe and can carry any number of
+// requests. Keeping one per host/port/scheme for the whole run, rather than
+// one per request, lets the session hand each new request a kept-alive
+// socket left by the previous one instead of a fresh TCP+TLS handshake.
+// Handles are closed at exit, before the sessions (declared after them).
+struct ConnPool {
+    struct Entry { WStr host; INTERNET_PORT port; bool https; HINTERNET h; };
+    const WSession& sess;
+    SRWLOCK         lock;
+    Vec<Entry>      v;
+    volatile LONG   nreq;
+    explicit ConnPool(const WSession& s) : sess(s), lock(SRWLOCK_INIT), nreq(0) {}
+    ~ConnPool() { for (size_t i = 0; i < v.n; ++i) WinHttpCloseHandle(v.p[i].h); }
+    ConnPool(const ConnPool&) = delete;
+    ConnPool& operator=(const ConnPool&) = delete;
+
+    HINTERNET find(const CrackResult& pu) const {
+        for (size_t i = 0; i < v.n; ++i) {
+            const Entry& e = v.p[i];
+            if (e.port == pu.port && e.https == pu.https && !wcscmp(e.host.c_str(), pu.host.c_str()))
+                return e.h;
+        }
+        return nullptr;
+    }
+    HINTERNET get(const CrackResult& pu) {
+        AcquireSRWLockShared(&lock);
+        HINTERNET h = find(pu);
+        ReleaseSRWLockShared(&lock);
+        if (h) return h;
+        AcquireSRWLockExclusive(&lock);
+        h = find(pu);
+        if (!h && (h = WinHttpConnect(sess.h, pu.host.c_str(), pu.port, 0))) {
+            Entry e{};
+            e.host.copy_from(pu.host);
+            e.port = pu.port; e.https = pu.https; e.h = h;
+            v.push_back(std::move(e));
+        }
+        ReleaseSRWLockExclusive(&lock);
+        return h;
+    }
+} g_conns(g_sess), g_aconns(g_asess);
+
+// A socket only returns to the keep-alive pool once its response has been
+// read to the end, so bodies that are not wanted (redirects) are drained.
+static void drain_req(HINTERNET hReq) {
+    char buf[4096];
+    DWORD rd = 0;
+    while (WinHttpReadData(hReq, buf, sizeof(buf), &rd) && rd) {}
+}
+
+static CrackResult crack_url(const WStr& url) {
+    CrackResult r{};
+    URL_COMPONENTS uc{};
+    uc.dwStructSize = sizeof(uc);
+    wchar_t host[512]{}, pth[4096]{};
+    uc.lpszHostName = host; uc.dwHostNameLength = 512;
+    uc.lpszUrlPath  = pth;  uc.dwUrlPathLength  = 4096;
+    WinHttpCrackUrl(url.c_str(), 0, 0, &uc);
+    r.host.assign_w(host);
+    r.path.assign_w(pth);
+    r.port  = uc.nPort;
+    r.https = (uc.nScheme == INTERNET_SCHEME_HTTPS);
+    return r;
+}
+
+static void set_insecure_tls(HINTERNET hReq) {
+    DWORD sec = SECURITY_FLAG_IGNORE_UNKNOWN_CA |
+                SECURITY_FLAG_IGNORE_CERT_DATE_INVALID |
+                SECURITY_FLAG_IGNORE_CERT_CN_INVALID;
+    WinHttpSetOption(hReq, WINHTTP_OPTION_SECURITY_FLAGS, &sec, sizeof(sec));
+}
+
+static bool is_redirect(DWORD status) {
+    return status == 301 || status == 302 || status == 303 ||
+           status == 307 || status == 308;
+}
+
+// Location header of a redirect response, or an empty string.
+static Str redirect_target(HINTERNET hReq) {
+    Str r{};
+    DWORD loc_sz = 0;
+    WinHttpQueryHeaders(hReq, WINHTTP_QUERY_LOCATION,
+        WINHTTP_HEADER_NAME_BY_INDEX, nullptr, &loc_sz, WINHTTP_NO_HEADER_INDEX);
+    if (loc_sz > 0) {
+        size_t wlen = loc_sz / sizeof(wchar_t) + 2;
+        wchar_t* loc = (wchar_t*)malloc(wlen * sizeof(wchar_t));
+        loc[0] = 0;
+        WinHttpQueryHeaders(hReq, WINHTTP_QUERY_LOCATION,
+            WINHTTP_HEADER_NAME_BY_INDEX, loc, &loc_sz, WINHTTP_NO_HEADER_INDEX);
+        size_t ln = wcslen(loc);
+        while (ln && loc[ln-1] == 0) --ln;
+        loc[ln] = 0;
+        r = to_utf8_str(loc);
+        free(loc);
+    }
+    return r;
+}
+
+// Start offset of a 206 response ("Content-Range: bytes <a>-<b>/<n>"), or -1.
+static LONGLONG content_range_start(HINTERNET hReq) {
+    wchar_t cr[128];
+    DWORD sz = sizeof(cr);
+    if (!WinHttpQueryHeaders(hReq, WINHTTP_QUERY_CONTENT_RANGE,
+            WINHTTP_HEADER_NAME_BY_INDEX, cr, &sz, WINHTTP_NO_HEADER_INDEX)) return -1;
+    const wchar_t* p = cr;
+    while (*p && (*p < L'0' || *p > L'9')) ++p;
+    if (!*p) return -1;
+    LONGLONG v = 0;
+    for (; *p >= L'0' && *p <= L'9'; ++p) v = v * 10 + (*p - L'0');
+    return v;
+}
+
+// Sends a GET (with optional extra request headers), following redirects.
+// The final status code is stored in *status_out when given.
+static HINTERNET open_req(const Str& url_s, const wchar_t* headers = nullptr,
+                          DWORD* status_out = nullptr) {
+    if (!g_sess.h) return nullptr;
+    Str cur{}; cur.copy_from(url_s);
+    const int max_redir = 10;
+
+    for (int i = 0; i <= max_redir; ++i) {
+        WStr wurl = to_wide_str(cur.c_str());
+        CrackResult pu = crack_url(wurl);
+
+        HINTERNET hConn = g_conns.get(pu);
+        if (!hConn) return nullptr;
+
+        DWORD flags = pu.https ? WINHTTP_FLAG_SECURE : 0;
+        HINTERNET hReq = WinHttpOpenRequest(hConn, L"GET", pu.path.c_str(),
+            nullptr, WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES, flags);
+        if (!hReq) return nullptr;
+
+        if (pu.https) set_insecure_tls(hReq);
+
+        if (!WinHttpSendRequest(hReq, headers ? headers : WINHTTP_NO_ADDITIONAL_HEADERS,
+                                headers ? (DWORD)-1L : 0, WINHTTP_NO_REQUEST_DATA, 0, 0, 0) ||
+            !WinHttpReceiveResponse(hReq, nullptr)) {
+            WinHttpCloseHandle(hReq);
+            return nullptr;
+        }
+        InterlockedIncrement(&g_conns.nreq);
+
+        DWORD status = 0, sz = sizeof(status);
+        WinHttpQueryHeaders(hReq,
+            WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+            WINHTTP_HEADER_NAME_BY_INDEX, &status, &sz, WINHTTP_NO_HEADER_INDEX);
+
+        if (is_redirect(status)) {
+            // Read Location header BEFORE closing the request handle.
+            Str loc = redirect_target(hReq);
+            if (!loc.empty()) cur = std::move(loc);
+            drain_req(hReq);
+            WinHttpCloseHandle(hReq);
+            continue;
+        }
+
+        if (status_out) *status_out = status;
+        return hReq;
+    }
+    return nullptr;
+}
+
+static bool http_get_stream(const Str& url, ChunkFn sink, void* ctx) {
+    HINTERNET hReq = open_req(url);
+    if (!hReq) return false;
+    bool ok = true, any = false;
+    char buf[65536];
+    DWORD rd = 0;
+    for (;;) {
+        if (!WinHttpReadData(hReq, buf, sizeof(buf), &rd)) { ok = false; break; }
+        if (!rd) break;
+        any = true;
+        if (!sink(ctx, buf, (size_t)rd)) { ok = false; break; }
+    }
+    WinHttpCloseHandle(hReq);
+    return ok && any;
+}
+
+[[nodiscard]] static Str http_get_str(const Str& url) {
+    Str result{};
+    http_get_stream(url, [](void* ctx, const char* p, size_t n) {
+        ((Str*)ctx)->append(p, n);
+        return true;
+    }, &result);
+    return result;
+}
+
+// Body bytes go to <dest>.part, which is renamed over dest only once the
+// transfer has completed, so dest never holds a partial file. A .part left
+// by an interrupted run is resumed with a Range request from its length.
+static WStr part_path(const WStr& dest) {
+    WStr r{}; r.copy_from(dest); r.append_w(L".part");
+    return r;
+}
+
+static void make_parent_dirs(const WStr& path) {
+    size_t n = path.n;
+    while (n && path.data()[n - 1] != L'\\' && path.data()[n - 1] != L'/') --n;
+    if (n > 1) create_dirs_n(path, n - 1);
+}
+
+static void range_header(wchar_t* out, size_t cap, LONGLONG off) {
+    swprintf(out, cap, L"Range: bytes=%lld-", (long long)off);
+}
+
+// How a response to a (possibly ranged) request should be written.
+enum PartMode { PART_FAIL, PART_RESTART, PART_APPEND, PART_TRUNCATE };
+
+static PartMode part_mode(HINTERNET hReq, DWORD status, LONGLONG off) {
+    if (status == 206) return content_range_start(hReq) == off ? PART_APPEND : PART_RESTART;
+    if (status == 416) return PART_RESTART;
+    if (status >= 400) return PART_FAIL;
+    return PART_TRUNCATE;
+}
+
+static HANDLE open_part(const WStr& part, PartMode mode) {
+    HANDLE h = CreateFileW(part.c_str(), GENERIC_WRITE, 0, nullptr,
+                           mode == PART_APPEND ? OPEN_ALWAYS : CREATE_ALWAYS,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h != INVALID_HANDLE_VALUE && mode == PART_APPEND) {
+        LARGE_INTEGER zero{};
+        SetFilePointerEx(h, zero, nullptr, FILE_END);
+    }
+    return h;
+}
+
+// Called once a task has finished, whether or not the file is now in place.
+typedef void (*DLThen)(void* ctx, const WStr& dest, bool ok);
+
+// Launch-critical tasks (client jar, libraries) are started before any
+// background one (asset objects) that is waiting.
+enum DLPrio : uint8_t { DLP_CRITICAL, DLP_BACKGROUND, DLP_COUNT };
+
+// sha1 and size are what the manifest promises for the file; an empty hash
+// or a zero size means it did not say. then, when set, runs on a pool thread
+// after the task and before the run counts it done.
+struct DLTask { Str url; WStr dest; Str sha1; int64_t size; DLThen then; void* then_ctx; DLPrio prio; };
+
+// What transfers report to the concurrency controller of their run, and the
+// bandwidth budget they share once pace_bps is set.
+struct DLStats {
+    volatile LONG64 rx;         // body bytes received
+    volatile LONG64 ttfb_us;    // summed time to response headers
+    volatile LONG   nttfb;
+    volatile LONG   nerr;       // attempts lost to the network or an overloaded server
+    volatile LONG64 pace_bps;   // 0 when unpaced
+    volatile LONG64 pace_next_us;
+};
+
+// Books len received bytes on the run's virtual clock and returns how long to
+// wait before reading more, so all its transfers together stay at pace_bps.
+static DWORD dl_pace(DLStats* st, DWORD len) {
+    if (!st || !st->pace_bps) return 0;
+    LONG64 now  = (LONG64)(now_ms() * 1000.0);
+    LONG64 cost = (LONG64)len * 1000000 / st->pace_bps;
+    for (;;) {
+        LONG64 next  = st->pace_next_us;
+        LONG64 start = next > now ? next : now;
+        if (InterlockedCompareExchange64(&st->pace_next_us, start + cost, next) == next)
+            return (DWORD)((start + cost - now) / 1000);
+    }
+}
+
+static void dl_note_ttfb(DLStats* st, double t0) {
+    if (!st) return;
+    InterlockedExchangeAdd64(&st->ttfb_us, (LONG64)((now_ms() - t0) * 1000.0));
+    InterlockedIncrement(&st->nttfb);
+}
+
+static void dl_note_err(DLStats* st) { if (st) InterlockedIncrement(&st->nerr); }
+
+// Timed out, throttled or server-side failures: worth retrying, and a sign
+// of too many requests in flight.
+static bool is_overload(DWORD status) { return status == 408 || status == 429 || status >= 500; }
+
+// A body that fails verification is deleted, so a retry starts from byte 0
+// rather than resuming from it. Transient failures are retried after a
+// jittered exponential backoff; permanent ones (a 404, a local write error)
+// are not retried at all.
+inline constexpr int   DL_MAX_TRIES       = 4;
+inline constexpr DWORD DL_BACKOFF_BASE_MS = 250;
+inline constexpr DWORD DL_BACKOFF_MAX_MS  = 8000;
+
+enum DLResult { DL_DONE, DL_TRANSIENT, DL_PERMANENT };
+
+// Uniform in [d/2, d] for d = base << attempt, so retries of tasks that
+// failed together (one server hiccup) do not arrive together again.
+static DWORD dl_backoff_ms(int attempt) {
+    static thread_local uint32_t seed = 0;
+    if (!seed) seed = (((uint32_t)GetCurrentThreadId() * 2654435761u) ^ (uint32_t)GetTickCount64()) | 1;
+    seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+    DWORD d = DL_BACKOFF_BASE_MS << (attempt < 5 ? attempt : 5);
+    if (d > DL_BACKOFF_MAX_MS) d = DL_BACKOFF_MAX_MS;
+    return d / 2 + seed % (d / 2 + 1);
+}
+
+// True for the hash of no data, which manifests give legitimately empty files.
+static bool sha1_is_empty(const Str& h) {
+    Sha1 e;
+    uint8_t d[20];
+    e.final(d);
+    return sha1_matches(d, h);
+}
+
+static bool dl_have(const DLTask& t) {
+    LONGLONG have = path_file_size(t.dest);
+    if (have == 0) return sha1_is_empty(t.sha1);
+    return have > 0 && (t.size <= 0 || have == t.size);
+}
+
+static bool dl_verify(const DLTask& t, Sha1& h, LONGLONG total) {
+    if (t.size > 0 && total != t.size) return false;
+    if (t.sha1.empty()) return true;
+    uint8_t d[20];
+    h.final(d);
+    return sha1_matches(d, t.sha1);
+}
+
+// True when the file at path has the given size and SHA-1; an empty sha1 or
+// a size <= 0 is not checked.
+static bool file_matches(const WStr& path, const Str& sha1, int64_t size) {
+    if (size > 0 && path_file_size(path) != size) return false;
+    if (sha1.empty()) return true;
+    Sha1 h;
+    if (!read_file_stream(path, sha1_feed, &h)) return false;
+    uint8_t d[20];
+    h.final(d);
+    return sha1_matches(d, sha1);
+}
+
+// ---- Shared content store ---------------------------------------------------
+//
+// With a store configured, every verified download is also kept as
+// <store>\<aa>\<sha1>, and a task whose hash is already there is hard-linked
+// (or copied, across volumes) into the root instead of fetched, so launcher
+// folders on one machine share a single copy of each file.
+inline WStr g_store;
+
+static bool sha1_is_hex(const Str& h) {
+    if (h.n != 40) return false;
+    for (size_t i = 0; i < 40; ++i)
+        if (!isxdigit((unsigned char)h[i])) return false;
+    return true;
+}
+
+// Store object of a task, or false if the store is off or the task has no hash.
+static bool store_object(const DLTask& t, PathBuf& out) {
+    if (g_store.empty() || !sha1_is_hex(t.sha1)) return false;
+    char pfx[3] = { t.sha1[0], t.sha1[1], 0 };
+    out.add(pfx).add(t.sha1.c_str());
+    return true;
+}
+
+// Drops a damaged store object, caught before use or through a damaged copy.
+static void store_evict(const DLTask& t) {
+    PathBuf obj(g_store);
+    if (store_object(t, obj)) DeleteFileW(obj.c_str());
+}
+
+// The object is hashed before use, so one damaged object is evicted rather
+// than spread into every root. A copy (across volumes) goes through the
+// task's .part name, since an interrupted CopyFileW leaves a file of full
+// size behind.
+static bool store_fetch(const DLTask& t) {
+    PathBuf src(g_store);
+    if (!store_object(t, src) || !path_exists_w(src.c_str())) return false;
+    if (!file_matches(src.wstr(), t.sha1, t.size)) { store_evict(t); return false; }
+    make_parent_dirs(t.dest);
+    DeleteFileW(t.dest.c_str());
+    if (CreateHardLinkW(t.dest.c_str(), src.c_str(), nullptr)) return true;
+    WStr part = part_path(t.dest);
+    if (CopyFileW(src.c_str(), part.c_str(), FALSE) &&
+        MoveFileExW(part.c_str(), t.dest.c_str(), MOVEFILE_REPLACE_EXISTING))
+        return true;
+    DeleteFileW(part.c_str());
+    return false;
+}
+
+static void store_publish(const DLTask& t) {
+    PathBuf obj(g_store);
+    if (!store_object(t, obj) || path_exists_w(obj.c_str())) return;
+    WStr objw = obj.wstr();
+    make_parent_dirs(objw);
+    if (CreateHardLinkW(obj.c_str(), t.dest.c_str(), nullptr)) return;
+    // Copies go through a private name so other launchers never see a
+    // partial object.
+    WStr tmp{}; tmp.copy_from(objw);
+    wchar_t sfx[32];
+    swprintf(sfx, 32, L".%lu.tmp", (unsigned long)GetCurrentThreadId());
+    tmp.append_w(sfx);
+    if (!CopyFileW(t.dest.c_str(), tmp.c_str(), FALSE) ||
+        !MoveFileExW(tmp.c_str(), obj.c_str(), 0))
+        DeleteFileW(tmp.c_str());
+}
+
+static DLResult http_download(const DLTask& t, DLStats* st) {
+    WStr part = part_path(t.dest);
+    make_parent_dirs(t.dest);
+    bool hashing = !t.sha1.empty();
+
+    // A second pass only happens when the server rejects the resume range.
+    for (int pass = 0; pass < 2; ++pass) {
+        LONGLONG off = path_file_size(part);
+        if (off < 0) off = 0;
+        wchar_t range[64];
+        if (off) range_header(range, 64, off);
+        DWORD status = 0;
+        double t0 = now_ms();
+        HINTERNET hReq = open_req(t.url, off ? range : nullptr, &status);
+        if (!hReq) { dl_note_err(st); return DL_TRANSIENT; }
+        dl_note_ttfb(st, t0);
+
+        PartMode mode = part_mode(hReq, status, off);
+        Sha1 h;
+        if (mode == PART_APPEND && hashing && !read_file_stream(part, sha1_feed, &h))
+            mode = PART_RESTART;
+        if (mode == PART_RESTART) {
+            WinHttpCloseHandle(hReq);
+            DeleteFileW(part.c_str());
+            continue;
+        }
+        if (mode == PART_FAIL) {
+            WinHttpCloseHandle(hReq);
+            if (!is_overload(status)) return DL_PERMANENT;
+            dl_note_err(st);
+            return DL_TRANSIENT;
+        }
+        if (mode == PART_TRUNCATE) off = 0;
+
+        HANDLE hFile = open_part(part, mode);
+        if (hFile == INVALID_HANDLE_VALUE) {
+            WinHttpCloseHandle(hReq);
+            return DL_PERMANENT;
+        }
+
+        bool ok = true;
+        char buf[131072];
+        DWORD rd = 0, wr = 0;
+        for (;;) {
+            if (!WinHttpReadData(hReq, buf, sizeof(buf), &rd)) { ok = false; dl_note_err(st); break; }
+            if (!rd) break;
+            if (!WriteFile(hFile, buf, rd, &wr, nullptr) || wr != rd) { ok = false; break; }
+            if (hashing) h.update(buf, rd);
+            if (st) InterlockedExchangeAdd64(&st->rx, rd);
+            off += rd;
+            if (DWORD d = dl_pace(st, rd)) Sleep(d);
+        }
+
+        CloseHandle(hFile);
+        WinHttpCloseHandle(hReq);
+        if (!ok) return DL_TRANSIENT;
+        if (!dl_verify(t, h, off)) { DeleteFileW(part.c_str()); return DL_TRANSIENT; }
+        return MoveFileExW(part.c_str(), t.dest.c_str(), MOVEFILE_REPLACE_EXISTING)
+            ? DL_DONE : DL_TRANSIENT;
+    }
+    return DL_TRANSIENT;
+}
+
+static bool download_file(const DLTask& t, DLStats* st = nullptr) {
+    if (dl_have(t) || store_fetch(t)) return true;
+    for (int i = 0; i < DL_MAX_TRIES; ++i) {
+        if (i) Sleep(dl_backoff_ms(i - 1));
+        DLResult r = http_download(t, st);
+        if (r == DL_DONE) { store_publish(t); return true; }
+        if (r == DL_PERMANENT) break;
+    }
+    return false;
+}
+
+// Tasks can be pushed while workers are already draining the queue, so a
+// planner that discovers work incrementally (a streamed index) never has to
+// hold the whole batch. Producers block once DLQ_MAX_PENDING tasks are waiting.
+inline constexpr size_t DLQ_MAX_PENDING = 4096;
+
+// One FIFO lane per priority; pop drains the most urgent non-empty lane.
+// The pending limit is per lane, so a backlog of assets never holds up
+// pushing a critical task.
+struct DLQueue {
+    SRWLOCK            lock;
+    CONDITION_VARIABLE cv;
+    Vec<DLTask>        tasks[DLP_COUNT];
+    size_t             next[DLP_COUNT];
+    LONG               total;
+    LONG               pushed[DLP_COUNT];
+    bool               closed;
+
+    DLQueue() : lock(SRWLOCK_INIT), cv(CONDITION_VARIABLE_INIT), next{}, total(0), pushed{}, closed(false) {}
+
+    void push(DLTask&& t) {
+        int l = t.prio;
+        AcquireSRWLockExclusive(&lock);
+        while (tasks[l].n - next[l] >= DLQ_MAX_PENDING) SleepConditionVariableSRW(&cv, &lock, INFINITE, 0);
+        tasks[l].push_back(std::move(t));
+        ++total;
+        ++pushed[l];
+        ReleaseSRWLockExclusive(&lock);
+        WakeAllConditionVariable(&cv);
+    }
+    bool pop(DLTask& out) {
+        AcquireSRWLockExclusive(&lock);
+        int l = 0;
+        for (;;) {
+            for (l = 0; l < DLP_COUNT && next[l] == tasks[l].n; ++l) {}
+            if (l < DLP_COUNT || closed) break;
+            SleepConditionVariableSRW(&cv, &lock, INFINITE, 0);
+        }
+        bool ok = l < DLP_COUNT;
+        if (ok) {
+            out = std::move(tasks[l].p[next[l]++]);
+            if (next[l] == tasks[l].n) { tasks[l].clear(); next[l] = 0; }
+        }
+        ReleaseSRWLockExclusive(&lock);
+        if (ok) WakeAllConditionVariable(&cv);
+        return ok;
+    }
+    void close() {
+        AcquireSRWLockExclusive(&lock);
+        closed = true;
+        ReleaseSRWLockExclusive(&lock);
+        WakeAllConditionVariable(&cv);
+    }
+};
+
+// ---- Adaptive concurrency ----------------------------------------------------
+//
+// Every transfer of a run holds one of run.slots while in flight, and a
+// governor thread resizes the slot count once per DL_CTL_WINDOW_MS from what
+// the window showed (AIMD). The limit starts in slow start, doubling while
+// throughput keeps rising by 10%; the doubling that gained nothing is undone.
+// After that it probes one slot at a time, keeping a probe only if the window
+// gained at least half an average slot's share of throughput, and waits
+// DL_CTL_COOLDOWN windows after a failed one. A window with failed or
+// overloaded (429/5xx) requests halves the limit; one whose time to headers
+// is over twice the best seen, without a throughput gain, takes a quarter
+// off, as the extra requests only queue. Windows in which the limit never
+// held a transfer back are not judged.
+
+// Bounds on in-flight transfers per run (settings "Connections").
+inline int g_dl_min = 4, g_dl_max = 96;
+
+inline constexpr double DL_CTL_WINDOW_MS = 500.0;
+inline constexpr int    DL_CTL_COOLDOWN  = 4;
+
+struct DLCtl {
+    int    limit, lo, hi, peak, cooldown;
+    bool   slow_start, probing;
+    double t_last, rate_last, ttfb_best;
+    LONG64 rx_last, ttfb_last;
+    LONG   nttfb_last, nerr_last, nblocked_last;
+};
+
+// Completion times of the most recent tasks, for the hedging p95.
+inline constexpr size_t DL_DUR_RING = 512;
+
+struct DLFlight;
+
+struct DLRun {
+    DLQueue        q;
+    Vec<HANDLE>    pool;
+    HANDLE         slots;      // free in-flight transfer slots
+    volatile LONG  ndone;
+    volatile LONG  ncrit_done; // DLP_CRITICAL tasks among ndone
+    volatile LONG  nfail;      // tasks given up on
+    volatile LONG  debt;       // slots to withhold after a shrink
+    volatile LONG  nblocked;   // transfers that had to wait for a slot
+    volatile LONG  finished;
+    volatile LONG  nhedged, hedges_live;
+    DLStats        st;
+    DLCtl          ctl;
+    double         t0;
+    SRWLOCK        flock;      // guards flights and dur
+    Vec<DLFlight*> flights;
+    float          dur[DL_DUR_RING];
+    size_t         ndur;
+#ifdef GOONMC_PROFILE
+    LONG           req0;
+#endif
+    DLRun() : slots(nullptr), ndone(0), ncrit_done(0), nfail(0), debt(0), nblocked(0), finished(0),
+              nhedged(0), hedges_live(0), st{}, ctl{}, t0(0), flock(SRWLOCK_INIT), ndur(0) {}
+};
+
+static void dl_slot_acquire(DLRun* run) {
+    if (WaitForSingleObject(run->slots, 0) == WAIT_OBJECT_0) return;
+    InterlockedIncrement(&run->nblocked);
+    WaitForSingleObject(run->slots, INFINITE);
+}
+
+// Must come before the task is counted done: dl_run_finish closes the
+// semaphore once every task is.
+static void dl_slot_release(DLRun* run) {
+    for (LONG d = run->debt; d > 0; d = run->debt)
+        if (InterlockedCompareExchange(&run->debt, d - 1, d) == d) return;
+    ReleaseSemaphore(run->slots, 1, nullptr);
+}
+
+static void dl_ctl_resize(DLRun& run, int to) {
+    DLCtl& c = run.ctl;
+    LONG grow = to - c.limit;
+    c.limit = to;
+    if (to > c.peak) c.peak = to;
+    if (grow < 0) { InterlockedExchangeAdd(&run.debt, -grow); return; }
+    for (LONG d = run.debt; grow > 0 && d > 0; d = run.debt)
+        if (InterlockedCompareExchange(&run.debt, d - 1, d) == d) --grow;
+    if (grow > 0) ReleaseSemaphore(run.slots, grow, nullptr);
+}
+
+static void dl_ctl_tick(DLRun& run) {
+    DLCtl& c = run.ctl;
+    // A paced run is bandwidth-bound by design; it only needs a few transfers.
+    if (run.st.pace_bps) {
+        if (c.limit > c.lo) dl_ctl_resize(run, c.lo);
+        return;
+    }
+    double now = now_ms(), dt = now - c.t_last;
+    if (dt < DL_CTL_WINDOW_MS) return;
+    LONG64 rx = run.st.rx, tt = run.st.ttfb_us;
+    LONG   nt = run.st.nttfb, ne = run.st.nerr, nb = run.nblocked;
+    double rate = (double)(rx - c.rx_last) / dt;
+    double ttfb = nt > c.nttfb_last ? (double)(tt - c.ttfb_last) / (nt - c.nttfb_last) : 0.0;
+    bool   errs = ne > c.nerr_last, bound = nb > c.nblocked_last;
+    double rate_last = c.rate_last;
+    c.t_last = now; c.rate_last = rate;
+    c.rx_last = rx; c.ttfb_last = tt; c.nttfb_last = nt; c.nerr_last = ne; c.nblocked_last = nb;
+    if (ttfb > 0 && (c.ttfb_best == 0 || ttfb < c.ttfb_best)) c.ttfb_best = ttfb;
+
+    int to = c.limit;
+    bool probed = c.probing;
+    c.probing = false;
+    if (errs) {
+        to = c.limit / 2;
+        c.slow_start = false;
+    } else if (!bound) {
+        return;
+    } else if (c.slow_start) {
+        if (c.limit >= c.hi) c.slow_start = false;
+        else if (rate > rate_last * 1.1) to = c.limit * 2;
+        else { to = c.limit / 2; c.slow_start = false; }
+    } else if (ttfb > 2 * c.ttfb_best && rate <= rate_last * 1.05) {
+        to = c.limit - c.limit / 4;
+    } else if (probed && rate < rate_last * (1.0 + 0.5 / c.limit)) {
+        to = c.limit - 1;
+        c.cooldown = DL_CTL_COOLDOWN;
+    } else if (c.cooldown > 0) {
+        --c.cooldown;
+    } else {
+        to = c.limit + 1;
+        c.probing = true;
+    }
+    if (to < c.lo) to = c.lo;
+    if (to > c.hi) to = c.hi;
+    if (to != c.limit) dl_ctl_resize(run, to);
+}
+
+struct DLThenJob { DLRun* run; DLThen fn; void* ctx; WStr dest; bool ok; DLPrio prio; };
+
+static void dl_count_done(DLRun* run, DLPrio prio) {
+    if (prio == DLP_CRITICAL) InterlockedIncrement(&run->ncrit_done);
+    InterlockedIncrement(&run->ndone);
+}
+
+static void CALLBACK dl_then_tp(PTP_CALLBACK_INSTANCE, void* arg) {
+    DLThenJob* j = (DLThenJob*)arg;
+    DLRun* run = j->run;
+    DLPrio prio = j->prio;
+    j->fn(j->ctx, j->dest, j->ok);
+    delete j;
+    dl_count_done(run, prio);
+}
+
+// Counts a task done, after its continuation if it has one. The slot it held
+// must already have been released.
+static void dl_task_done(DLRun* run, DLTask& t, bool ok) {
+    if (!ok) InterlockedIncrement(&run->nfail);
+    if (!t.then) { dl_count_done(run, t.prio); return; }
+    DLThenJob* j = new DLThenJob{ run, t.then, t.then_ctx, std::move(t.dest), ok, t.prio };
+    if (!TrySubmitThreadpoolCallback(dl_then_tp, j, nullptr)) dl_then_tp(nullptr, j);
+}
+
+static void dl_hedge_tick(DLRun& run);
+
+static DWORD WINAPI dl_governor(LPVOID arg) {
+    DLRun* run = (DLRun*)arg;
+    while (!run->finished) {
+        Sleep(100);
+        dl_ctl_tick(*run);
+        dl_hedge_tick(*run);
+    }
+    return 0;
+}
+
+static DWORD WINAPI dl_worker(LPVOID arg) {
+    DLRun* run = (DLRun*)arg;
+    DLTask t{};
+    while (run->q.pop(t)) {
+        dl_slot_acquire(run);
+        bool ok = download_file(t, &run->st);
+        dl_slot_release(run);
+        dl_task_done(run, t, ok);
+    }
+    return 0;
+}
+
+// ---- Async download engine -------------------------------------------------
+//
+// With the async session available, a run is one driver thread that pops
+// tasks and starts them, with as many transfers in flight as the run's
+// slots allow. Every transfer advances from WinHTTP's completion
+// callbacks (send -> headers -> read/write loop), which run on the WinHTTP
+// I/O completion port pool, so no thread blocks per transfer. A transfer owns
+// at most one request handle at a time and finishes in its HANDLE_CLOSING
+// callback, which is the last one WinHTTP makes for that handle. Failed
+// attempts are retried from a thread-pool timer after the backoff delay.
+//
+// Each task is a flight of up to two transfers. When the primary has run
+// DL_HEDGE_FACTOR times the run's p95 completion time and has also gone that
+// p95 (at least DL_HEDGE_MIN_MS) without data, the governor starts a hedge for
+// it into a separate part file, outside the concurrency limit. The first to
+// complete wins and closes the other's request; the task counts as done once
+// both have finished, so a batch ends on the faster copy of a stalled file.
+
+// Reads that complete synchronously re-enter the callback on the same stack;
+// past this depth the next read is bounced to the thread pool instead.
+inline constexpr int AX_MAX_NEST = 8;
+
+inline constexpr double DL_HEDGE_FACTOR      = 2.0;
+inline constexpr double DL_HEDGE_MIN_MS      = 1000.0;
+inline constexpr size_t DL_HEDGE_MIN_SAMPLES = 20;
+inline constexpr LONG   DL_HEDGE_MAX         = 8;     // hedges in flight per run
+
+struct AXfer;
+
+struct DLFlight {
+    SRWLOCK         lock;
+    AXfer*          x[2];        // live transfers: primary, hedge
+    int             live;
+    bool            won, hedged;
+    double          t0;
+    volatile LONG64 t_prog;      // now_ms() of the last data, in microseconds
+};
+
+struct AXfer {
+    DLRun*    run;
+    DLFlight* fl;
+    bool      hedge, fatal;
+    DLTask    t;
+    WStr      part;
+    LONGLONG  off;       // bytes in part: the Range start, then the running length
+    HINTERNET req;
+    SRWLOCK   rlock;     // guards req against the flight's winner: busy, cancel
+    int       busy;      // WinHTTP calls on req in progress
+    bool      cancel;    // the other transfer of the flight won
+    volatile LONG refs;  // the transfer itself, queued pool callbacks and calls in progress
+    HANDLE    file;
+    double    t_sent;    // when the current request was sent
+    Str       next_url;
+    int       redirects, tries;
+    bool      ok, redirecting;
+    Sha1      h;
+    char      buf[65536];
+};
+
+static thread_local int ax_nest = 0;
+
+static void ax_close_file(AXfer* x) {
+    if (x->file != INVALID_HANDLE_VALUE) CloseHandle(x->file);
+    x->file = INVALID_HANDLE_VALUE;
+}
+
+// Takes the request handle so exactly one caller closes it, whether the
+// transfer itself or the winner of its flight.
+static HINTERNET ax_take_req(AXfer* x) {
+    return (HINTERNET)InterlockedExchangePointer((void* volatile*)&x->req, nullptr);
+}
+
+static void ax_close(AXfer* x) {
+    if (HINTERNET r = ax_take_req(x)) WinHttpCloseHandle(r);
+}
+
+static void ax_unref(AXfer* x) {
+    if (!InterlockedDecrement(&x->refs)) delete x;
 }
 
-static Str read_file(const WStr& path) {
-    Str r{};
-    HANDLE h = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
-                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-    if (h == INVALID_HANDLE_VALUE) return r;
-    DWORD sz = GetFileSize(h, nullptr);
-    if (sz && sz != INVALID_FILE_SIZE) {
-        r.grow((size_t)sz);
-        DWORD rd = 0;
-        ReadFile(h, r.p, sz, &rd, nullptr);
-        r.n = (size_t)rd;
-        if (r.p) r.p[r.n] = 0;
-    }
-    CloseHandle(h);
+// Borrows req for a WinHTTP call, or returns null once the flight has been
+// won by the other transfer. Every successful ax_use is paired with ax_unuse
+// after the call, which also keeps x alive across callbacks the call runs
+// inline.
+static HINTERNET ax_use(AXfer* x) {
+    AcquireSRWLockExclusive(&x->rlock);
+    HINTERNET r = x->cancel ? nullptr : x->req;
+    if (r) { ++x->busy; InterlockedIncrement(&x->refs); }
+    ReleaseSRWLockExclusive(&x->rlock);
     return r;
 }
 
-static void write_file(const WStr& path, const char* data, size_t len) {
-    HANDLE h = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr,
-                           CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
-    if (h == INVALID_HANDLE_VALUE) return;
-    DWORD wr = 0;
-    WriteFile(h, data, (DWORD)len, &wr, nullptr);
-    CloseHandle(h);
+static void ax_unuse(AXfer* x) {
+    AcquireSRWLockExclusive(&x->rlock);
+    HINTERNET r = --x->busy == 0 && x->cancel ? ax_take_req(x) : nullptr;
+    ReleaseSRWLockExclusive(&x->rlock);
+    if (r) WinHttpCloseHandle(r);
+    ax_unref(x);
 }
 
-static Str read_line() {
-    Str r{};
-    int c;
-    while ((c = getchar()) != EOF && c != '\n')
-        r.append_c((char)c);
-    if (!r.empty() && r.back() == '\r') r.pop_back();
+// Stops the losing transfer o for the winner of its flight. A handle that o
+// is in the middle of a call on is left for o to close in ax_unuse, so no
+// call is ever made on a handle closed under it.
+static HINTERNET ax_cancel(AXfer* o) {
+    AcquireSRWLockExclusive(&o->rlock);
+    o->cancel = true;
+    HINTERNET r = o->busy ? nullptr : ax_take_req(o);
+    ReleaseSRWLockExclusive(&o->rlock);
     return r;
 }
 
-static bool parse_int(const Str& s, int* out) {
-    if (s.empty()) return false;
-    size_t start = (s.p[0] == '-') ? 1 : 0;
-    if (start >= s.n) return false;
-    for (size_t i = start; i < s.n; ++i)
-        if (!isdigit((uint8_t)s.p[i])) return false;
-    *out = atoi(s.c_str());
-    return true;
+static bool ax_lost(AXfer* x) {
+    AcquireSRWLockShared(&x->fl->lock);
+    bool won = x->fl->won;
+    ReleaseSRWLockShared(&x->fl->lock);
+    return won;
 }
 
-struct WSession {
-    HINTERNET h = nullptr;
-    WSession() {
-        h = WinHttpOpen(L"GoonMC/1.0",
-            WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
-            WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
-        if (h) {
-            DWORD pol = WINHTTP_OPTION_REDIRECT_POLICY_NEVER;
-            WinHttpSetOption(h, WINHTTP_OPTION_REDIRECT_POLICY, &pol, sizeof(pol));
-        }
+static void dl_flight_drop(DLRun* run, DLFlight* fl) {
+    AcquireSRWLockExclusive(&run->flock);
+    for (size_t i = 0; i < run->flights.n; ++i)
+        if (run->flights.p[i] == fl) { run->flights.p[i] = run->flights.p[--run->flights.n]; break; }
+    ReleaseSRWLockExclusive(&run->flock);
+    delete fl;
+}
+
+static void ax_finish(AXfer* x) {
+    ax_close_file(x);
+    DLRun*    run = x->run;
+    DLFlight* fl  = x->fl;
+    HINTERNET cancel = nullptr;
+    AcquireSRWLockExclusive(&fl->lock);
+    fl->x[x->hedge] = nullptr;
+    bool won = x->ok && !fl->won;
+    if (won) {
+        fl->won = true;
+        if (AXfer* o = fl->x[!x->hedge]) cancel = ax_cancel(o);
+    }
+    bool lost = !x->ok && (x->hedge || fl->won);
+    bool last = --fl->live == 0, done = fl->won;
+    ReleaseSRWLockExclusive(&fl->lock);
+    // Closed outside the lock: its HANDLE_CLOSING may arrive on this thread.
+    if (cancel) WinHttpCloseHandle(cancel);
+    if (lost) DeleteFileW(x->part.c_str());
+    if (won) {
+        AcquireSRWLockExclusive(&run->flock);
+        run->dur[run->ndur++ % DL_DUR_RING] = (float)(now_ms() - fl->t0);
+        ReleaseSRWLockExclusive(&run->flock);
     }
-    ~WSession() { if (h) WinHttpCloseHandle(h); }
-    WSession(const WSession&) = delete;
-    WSession& operator=(const WSession&) = delete;
-} g_sess;
 
-struct CrackResult { WStr host, path; INTERNET_PORT port; bool https; };
+    if (x->hedge) InterlockedDecrement(&run->hedges_live);
+    else          dl_slot_release(run);
+    if (last) {
+        dl_flight_drop(run, fl);
+        dl_task_done(run, x->t, done);
+    }
+    ax_unref(x);
+}
 
-static CrackResult crack_url(const WStr& url) {
-    CrackResult r{};
-    URL_COMPONENTS uc{};
-    uc.dwStructSize = sizeof(uc);
-    wchar_t host[512]{}, pth[4096]{};
-    uc.lpszHostName = host; uc.dwHostNameLength = 512;
-    uc.lpszUrlPath  = pth;  uc.dwUrlPathLength  = 4096;
-    WinHttpCrackUrl(url.c_str(), 0, 0, &uc);
-    r.host.assign_w(host);
-    r.path.assign_w(pth);
-    r.port  = uc.nPort;
-    r.https = (uc.nScheme == INTERNET_SCHEME_HTTPS);
-    return r;
+static void ax_fail(AXfer* x) {
+    x->ok = false;
+    ax_close(x);
 }
 
-static HINTERNET open_req(const Str& url_s, HINTERNET& out_conn, int max_redir = 10) {
-    if (!g_sess.h) return nullptr;
-    Str cur{}; cur.copy_from(url_s);
+// Opens and sends a request for url. Returns false if no handle was created,
+// in which case no callback will ever arrive for it.
+static bool ax_start(AXfer* x, const Str& url) {
+    WStr wurl = to_wide_str(url.c_str());
+    CrackResult pu = crack_url(wurl);
+    HINTERNET hConn = g_aconns.get(pu);
+    if (!hConn) return false;
+    HINTERNET r = WinHttpOpenRequest(hConn, L"GET", pu.path.c_str(), nullptr,
+        WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES, pu.https ? WINHTTP_FLAG_SECURE : 0);
+    if (!r) return false;
+    DWORD_PTR ctx = (DWORD_PTR)x;
+    WinHttpSetOption(r, WINHTTP_OPTION_CONTEXT_VALUE, &ctx, sizeof(ctx));
+    if (pu.https) set_insecure_tls(r);
+    AcquireSRWLockExclusive(&x->rlock);
+    x->req = r;
+    ReleaseSRWLockExclusive(&x->rlock);
+    wchar_t range[64];
+    if (x->off) range_header(range, 64, x->off);
+    x->t_sent = now_ms();
+    if (!(r = ax_use(x))) { ax_fail(x); return true; }
+    if (!WinHttpSendRequest(r, x->off ? range : WINHTTP_NO_ADDITIONAL_HEADERS,
+                            x->off ? (DWORD)-1L : 0, WINHTTP_NO_REQUEST_DATA, 0, 0, ctx))
+        ax_fail(x);
+    ax_unuse(x);
+    return true;
+}
 
-    for (int i = 0; i <= max_redir; ++i) {
-        WStr wurl = to_wide_str(cur.c_str());
-        CrackResult pu = crack_url(wurl);
+static void ax_read(AXfer* x) {
+    HINTERNET r = ax_use(x);
+    if (!r) { ax_fail(x); return; }
+    if (!WinHttpReadData(r, x->buf, sizeof(x->buf), nullptr)) ax_fail(x);
+    ax_unuse(x);
+}
 
-        HINTERNET hConn = WinHttpConnect(g_sess.h, pu.host.c_str(), pu.port, 0);
-        if (!hConn) return nullptr;
+// Reads queued on the pool (deferred or paced) hold a reference to x, since
+// its flight may be won and x finished before they run.
+static void CALLBACK ax_read_tp(PTP_CALLBACK_INSTANCE, void* ctx) {
+    AXfer* x = (AXfer*)ctx;
+    ax_read(x);
+    ax_unref(x);
+}
 
-        DWORD flags = pu.https ? WINHTTP_FLAG_SECURE : 0;
-        HINTERNET hReq = WinHttpOpenRequest(hConn, L"GET", pu.path.c_str(),
-            nullptr, WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES, flags);
-        if (!hReq) { WinHttpCloseHandle(hConn); return nullptr; }
+static void ax_on_headers(AXfer* x, HINTERNET req) {
+    DWORD status = 0, sz = sizeof(status);
+    WinHttpQueryHeaders(req, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+        WINHTTP_HEADER_NAME_BY_INDEX, &status, &sz, WINHTTP_NO_HEADER_INDEX);
+    dl_note_ttfb(&x->run->st, x->t_sent);
+    if (is_redirect(status)) {
+        Str loc = redirect_target(req);
+        if (!loc.empty()) x->next_url = std::move(loc);
+        else              x->next_url.copy_from(x->t.url);
+        x->redirecting = true;
+        ax_close(x);
+        return;
+    }
+    PartMode mode = part_mode(req, status, x->off);
+    x->h.reset();
+    if (mode == PART_APPEND && !x->t.sha1.empty() && !read_file_stream(x->part, sha1_feed, &x->h))
+        mode = PART_RESTART;
+    if (mode == PART_RESTART && x->off) {
+        // Reissue from byte 0 through the redirect path.
+        DeleteFileW(x->part.c_str());
+        x->off = 0;
+        x->next_url.copy_from(x->t.url);
+        x->redirecting = true;
+        ax_close(x);
+        return;
+    }
+    if (mode == PART_FAIL) {
+        if (is_overload(status)) dl_note_err(&x->run->st);
+        else                     x->fatal = true;
+    }
+    if (mode == PART_FAIL || mode == PART_RESTART) { ax_fail(x); return; }
+    if (mode == PART_TRUNCATE) x->off = 0;
+    make_parent_dirs(x->t.dest);
+    x->file = open_part(x->part, mode);
+    if (x->file == INVALID_HANDLE_VALUE) { x->fatal = true; ax_fail(x); return; }
+    ax_read(x);
+}
 
-        if (pu.https) {
-            DWORD sec = SECURITY_FLAG_IGNORE_UNKNOWN_CA |
-                        SECURITY_FLAG_IGNORE_CERT_DATE_INVALID |
-                        SECURITY_FLAG_IGNORE_CERT_CN_INVALID;
-            WinHttpSetOption(hReq, WINHTTP_OPTION_SECURITY_FLAGS, &sec, sizeof(sec));
-        }
+static void ax_headers(AXfer* x) {
+    HINTERNET r = ax_use(x);
+    if (!r) { ax_fail(x); return; }
+    ax_on_headers(x, r);
+    ax_unuse(x);
+}
 
-        if (!WinHttpSendRequest(hReq, WINHTTP_NO_ADDITIONAL_HEADERS, 0,
-                                WINHTTP_NO_REQUEST_DATA, 0, 0, 0) ||
-            !WinHttpReceiveResponse(hReq, nullptr)) {
-            WinHttpCloseHandle(hReq); WinHttpCloseHandle(hConn);
-            return nullptr;
-        }
+// The body is complete: verify it and move it into place. A mismatch leaves
+// ok false, so ax_closed retries the task from scratch.
+static void ax_complete(AXfer* x) {
+    ax_close_file(x);
+    if (ax_lost(x)) {
+        x->ok = false;
+    } else if (dl_verify(x->t, x->h, x->off)) {
+        x->ok = MoveFileExW(x->part.c_str(), x->t.dest.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+        if (x->ok) store_publish(x->t);
+    } else
+        DeleteFileW(x->part.c_str());
+    ax_close(x);
+}
 
-        DWORD status = 0, sz = sizeof(status);
-        WinHttpQueryHeaders(hReq,
-            WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
-            WINHTTP_HEADER_NAME_BY_INDEX, &status, &sz, WINHTTP_NO_HEADER_INDEX);
+static void CALLBACK ax_pace_tp(PTP_CALLBACK_INSTANCE inst, void* ctx, PTP_TIMER tm) {
+    CloseThreadpoolTimer(tm);
+    ax_read_tp(inst, ctx);
+}
 
-        if (status == 301 || status == 302 || status == 303 ||
-            status == 307 || status == 308) {
-            DWORD loc_sz = 0;
-            WinHttpQueryHeaders(hReq, WINHTTP_QUERY_LOCATION,
-                WINHTTP_HEADER_NAME_BY_INDEX, nullptr, &loc_sz, WINHTTP_NO_HEADER_INDEX);
-            // Read Location header BEFORE closing the request handle.
-            if (loc_sz > 0) {
-                size_t wlen = loc_sz / sizeof(wchar_t) + 2;
-                wchar_t* loc = (wchar_t*)malloc(wlen * sizeof(wchar_t));
-                loc[0] = 0;
-                WinHttpQueryHeaders(hReq, WINHTTP_QUERY_LOCATION,
-                    WINHTTP_HEADER_NAME_BY_INDEX, loc, &loc_sz, WINHTTP_NO_HEADER_INDEX);
-                size_t ln = wcslen(loc);
-                while (ln && loc[ln-1] == 0) --ln;
-                loc[ln] = 0;
-                cur = to_utf8_str(loc);
-                free(loc);
-            }
-            WinHttpCloseHandle(hReq); WinHttpCloseHandle(hConn);
-            continue;
-        }
+// Runs cb for x after ms on a one-shot pool timer; false if none could be made.
+// The timer holds a reference to x that cb drops.
+static bool ax_after(AXfer* x, DWORD ms, PTP_TIMER_CALLBACK cb) {
+    PTP_TIMER tm = CreateThreadpoolTimer(cb, x, nullptr);
+    if (!tm) return false;
+    InterlockedIncrement(&x->refs);
+    ULARGE_INTEGER due;
+    due.QuadPart = (ULONGLONG)(-(LONGLONG)ms * 10000);
+    FILETIME ft{ due.LowPart, due.HighPart };
+    SetThreadpoolTimer(tm, &ft, 0, 0);
+    return true;
+}
 
-        out_conn = hConn;
-        return hReq;
+static void ax_read_done(AXfer* x, DWORD len) {
+    if (!len) { ax_complete(x); return; }
+    DWORD wr = 0;
+    if (!WriteFile(x->file, x->buf, len, &wr, nullptr) || wr != len) { ax_fail(x); return; }
+    if (!x->t.sha1.empty()) x->h.update(x->buf, len);
+    InterlockedExchangeAdd64(&x->run->st.rx, len);
+    InterlockedExchange64(&x->fl->t_prog, (LONG64)(now_ms() * 1000.0));
+    x->off += len;
+    if (DWORD d = dl_pace(&x->run->st, len))
+        if (ax_after(x, d, ax_pace_tp)) return;
+    if (ax_nest > AX_MAX_NEST) {
+        InterlockedIncrement(&x->refs);
+        if (TrySubmitThreadpoolCallback(ax_read_tp, x, nullptr)) return;
+        InterlockedDecrement(&x->refs);
     }
-    return nullptr;
+    ax_read(x);
 }
 
-[[nodiscard]] static Str http_get_str(const Str& url) {
-    HINTERNET hConn = nullptr;
-    HINTERNET hReq  = open_req(url, hConn);
-    Str result{};
-    if (!hReq) return result;
-    char buf[65536];
-    DWORD rd = 0;
-    while (WinHttpReadData(hReq, buf, sizeof(buf), &rd) && rd)
-        result.append(buf, (size_t)rd);
-    WinHttpCloseHandle(hReq); WinHttpCloseHandle(hConn);
-    return result;
+static void CALLBACK ax_retry_tp(PTP_CALLBACK_INSTANCE, void* ctx, PTP_TIMER tm) {
+    CloseThreadpoolTimer(tm);
+    AXfer* x = (AXfer*)ctx;
+    if (ax_lost(x) || !ax_start(x, x->t.url)) ax_finish(x);
+    ax_unref(x);
 }
 
-inline CRITICAL_SECTION g_mkdir_cs;
-
-static bool http_download(const Str& url, const WStr& dest) {
-    HINTERNET hConn = nullptr;
-    HINTERNET hReq  = open_req(url, hConn);
-    if (!hReq) return false;
-
-    {
-        EnterCriticalSection(&g_mkdir_cs);
-        WStr parent = path_parent(dest);
-        if (!parent.empty()) create_dirs(parent);
-        LeaveCriticalSection(&g_mkdir_cs);
+static void ax_closed(AXfer* x) {
+    if (x->redirecting) {
+        x->redirecting = false;
+        Str next = std::move(x->next_url);
+        if (!ax_lost(x) && ++x->redirects <= 10 && ax_start(x, next)) return;
+        x->ok = false;
     }
-
-    HANDLE hFile = CreateFileW(dest.c_str(), GENERIC_WRITE, 0, nullptr,
-                               CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
-    if (hFile == INVALID_HANDLE_VALUE) {
-        WinHttpCloseHandle(hReq); WinHttpCloseHandle(hConn);
-        return false;
+    if (!x->ok && !x->fatal && !ax_lost(x) && ++x->tries < DL_MAX_TRIES) {
+        // Resumes from whatever of the part survived; a body that failed
+        // verification has already been deleted.
+        ax_close_file(x);
+        x->off = path_file_size(x->part);
+        if (x->off < 0) x->off = 0;
+        x->redirects = 0;
+        if (ax_after(x, dl_backoff_ms(x->tries - 1), ax_retry_tp)) return;
+        if (ax_start(x, x->t.url)) return;
     }
+    ax_finish(x);
+}
 
-    bool ok = true;
-    char buf[131072];
-    DWORD rd = 0, wr = 0;
-    while (WinHttpReadData(hReq, buf, sizeof(buf), &rd) && rd) {
-        if (!WriteFile(hFile, buf, rd, &wr, nullptr) || wr != rd) { ok = false; break; }
+static void CALLBACK ax_callback(HINTERNET, DWORD_PTR ctx, DWORD status, LPVOID, DWORD len) {
+    AXfer* x = (AXfer*)ctx;
+    if (!x) return;
+    ++ax_nest;
+    switch (status) {
+        case WINHTTP_CALLBACK_STATUS_SENDREQUEST_COMPLETE: {
+            HINTERNET r = ax_use(x);
+            if (!r || !WinHttpReceiveResponse(r, nullptr)) ax_fail(x);
+            if (r) ax_unuse(x);
+            break;
+        }
+        case WINHTTP_CALLBACK_STATUS_HEADERS_AVAILABLE: ax_headers(x);        break;
+        case WINHTTP_CALLBACK_STATUS_READ_COMPLETE:     ax_read_done(x, len); break;
+        case WINHTTP_CALLBACK_STATUS_REQUEST_ERROR:
+            dl_note_err(&x->run->st);
+            ax_fail(x);
+            break;
+        case WINHTTP_CALLBACK_STATUS_HANDLE_CLOSING:    ax_closed(x);         break;
     }
+    --ax_nest;
+}
 
-    CloseHandle(hFile);
-    WinHttpCloseHandle(hReq); WinHttpCloseHandle(hConn);
-    if (!ok) DeleteFileW(dest.c_str());
-    return ok;
+static DWORD WINAPI dl_driver(LPVOID arg) {
+    DLRun* run = (DLRun*)arg;
+    DLTask t{};
+    while (run->q.pop(t)) {
+        if (dl_have(t) || store_fetch(t)) { dl_task_done(run, t, true); continue; }
+        dl_slot_acquire(run);
+        AXfer* x = new AXfer{};
+        x->run  = run;
+        x->t    = std::move(t);
+        x->part = part_path(x->t.dest);
+        x->off  = path_file_size(x->part);
+        if (x->off < 0) x->off = 0;
+        x->file = INVALID_HANDLE_VALUE;
+        x->rlock = SRWLOCK_INIT;
+        x->refs  = 1;
+        DLFlight* fl = new DLFlight{};
+        fl->lock   = SRWLOCK_INIT;
+        fl->x[0]   = x;
+        fl->live   = 1;
+        fl->t0     = now_ms();
+        fl->t_prog = (LONG64)(fl->t0 * 1000.0);
+        x->fl = fl;
+        AcquireSRWLockExclusive(&run->flock);
+        run->flights.push_back(fl);
+        ReleaseSRWLockExclusive(&run->flock);
+        if (!ax_start(x, x->t.url)) ax_finish(x);
+    }
+    return 0;
 }
 
-static bool download_file(const Str& url, const WStr& dest) {
-    if (path_exists(dest) && path_file_size(dest) > 0) return true;
-    return http_download(url, dest);
+static int cmp_float(const void* a, const void* b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return x < y ? -1 : x > y;
 }
 
-struct DLTask { Str url; WStr dest; };
+static void dl_hedge_tick(DLRun& run) {
+    if (!g_asess.h || run.st.pace_bps || run.hedges_live >= DL_HEDGE_MAX) return;
+    float d[DL_DUR_RING];
+    AcquireSRWLockShared(&run.flock);
+    size_t n = run.ndur < DL_DUR_RING ? run.ndur : DL_DUR_RING;
+    memcpy(d, run.dur, n * sizeof(float));
+    ReleaseSRWLockShared(&run.flock);
+    if (n < DL_HEDGE_MIN_SAMPLES) return;
+    qsort(d, n, sizeof(float), cmp_float);
+    double p95 = d[n * 95 / 100];
+    double quiet = p95 > DL_HEDGE_MIN_MS ? p95 : DL_HEDGE_MIN_MS;
+    double now = now_ms();
+
+    AXfer* start[DL_HEDGE_MAX];
+    LONG ns = 0;
+    AcquireSRWLockShared(&run.flock);
+    for (size_t i = 0; i < run.flights.n && run.hedges_live + ns < DL_HEDGE_MAX; ++i) {
+        DLFlight* fl = run.flights.p[i];
+        if (now - fl->t0 < DL_HEDGE_FACTOR * p95 || now - fl->t_prog / 1000.0 < quiet) continue;
+        AcquireSRWLockExclusive(&fl->lock);
+        if (!fl->won && !fl->hedged && fl->x[0]) {
+            const DLTask& pt = fl->x[0]->t;
+            AXfer* h = new AXfer{};
+            h->run   = &run;
+            h->fl    = fl;
+            h->hedge = true;
+            h->t.url.copy_from(pt.url);
+            h->t.dest.copy_from(pt.dest);
+            h->t.sha1.copy_from(pt.sha1);
+            h->t.size = pt.size;
+            h->t.then = pt.then;
+            h->t.then_ctx = pt.then_ctx;
+            h->t.prio = pt.prio;
+            h->part  = part_path(pt.dest);
+            h->part.append_w(L".hedge");
+            h->file  = INVALID_HANDLE_VALUE;
+            h->rlock = SRWLOCK_INIT;
+            h->refs  = 1;
+            fl->x[1] = h;
+            fl->hedged = true;
+            ++fl->live;
+            start[ns++] = h;
+        }
+        ReleaseSRWLockExclusive(&fl->lock);
+    }
+    ReleaseSRWLockShared(&run.flock);
+    // Started outside the locks, since a failed start finishes the transfer.
+    for (LONG i = 0; i < ns; ++i) {
+        InterlockedIncrement(&run.hedges_live);
+        InterlockedIncrement(&run.nhedged);
+        if (ax_lost(start[i]) || !ax_start(start[i], start[i]->t.url)) ax_finish(start[i]);
+    }
+}
 
-struct DLThreadCtx {
-    DLTask*        tasks;
-    volatile LONG* cursor;
-    volatile LONG* ndone;
-    LONG           total;
-};
+// start is the initial concurrency; ntasks, when known, caps it.
+static void dl_run_start(DLRun& run, int start, size_t ntasks = 0) {
+    run.t0 = now_ms();
+#ifdef GOONMC_PROFILE
+    run.req0 = g_conns.nreq;
+#endif
+    DLCtl& c = run.ctl;
+    c.hi = g_dl_max;
+    if (ntasks && ntasks < (size_t)c.hi) c.hi = (int)ntasks;
+    c.lo = g_dl_min < c.hi ? g_dl_min : c.hi;
+    c.limit = start < c.lo ? c.lo : start > c.hi ? c.hi : start;
+    c.peak = c.limit;
+    c.slow_start = true;
+    c.t_last = run.t0;
+    run.slots = CreateSemaphoreW(nullptr, c.limit, c.hi, nullptr);
+
+    if (g_asess.h) {
+        run.pool.push_back(CreateThread(nullptr, 0, dl_driver, &run, 0, nullptr));
+    } else {
+        // Blocking fallback: one thread per possible slot.
+        run.pool.reserve((size_t)c.hi + 1);
+        for (int t = 0; t < c.hi; ++t)
+            run.pool.push_back(CreateThread(nullptr, 0, dl_worker, &run, 0, nullptr));
+    }
+    run.pool.push_back(CreateThread(nullptr, 0, dl_governor, &run, 0, nullptr));
+}
 
-static DWORD WINAPI dl_worker(LPVOID arg) {
-    DLThreadCtx* ctx = (DLThreadCtx*)arg;
-    for (;;) {
-        LONG i = InterlockedExchangeAdd(ctx->cursor, 1);
-        if (i >= ctx->total) break;
-        download_file(ctx->tasks[i].url, ctx->tasks[i].dest);
-        InterlockedIncrement(ctx->ndone);
+// Closes the queue and reports progress until every pushed task is done.
+static void dl_run_finish(DLRun& run) {
+    run.q.close();
+    LONG total = run.q.total;
+    while (run.ndone < total) {
+        printf("  %ld/%ld\r", run.ndone, total);
+        fflush(stdout);
+        Sleep(100);
     }
-    return 0;
+    run.finished = 1;
+    WaitForMultipleObjects((DWORD)run.pool.n, run.pool.p, TRUE, INFINITE);
+    for (size_t t = 0; t < run.pool.n; ++t) CloseHandle(run.pool.p[t]);
+    run.pool.clear();
+    if (run.slots) { CloseHandle(run.slots); run.slots = nullptr; }
+    if (total) printf("  %ld/%ld\n", total, total);
+    double ms = now_ms() - run.t0;
+    if (run.st.rx)
+        printf("  %.1f MB at %.1f MB/s, concurrency %d (peak %d, range %d-%d)\n",
+               run.st.rx / 1048576.0, ms > 0 ? run.st.rx / 1048.576 / ms : 0.0,
+               run.ctl.limit, run.ctl.peak, run.ctl.lo, run.ctl.hi);
+    if (run.nhedged) printf("  %ld stalled transfer(s) hedged\n", run.nhedged);
+    if (run.nfail)   fprintf(stderr, "  %ld file(s) failed to download\n", run.nfail);
+#ifdef GOONMC_PROFILE
+    LONG reqs = g_conns.nreq - run.req0;
+    fprintf(stderr, "[prof] %ld requests in %.0f ms (%.1f req/s) over %zu pooled connection(s)\n",
+            reqs, ms, ms > 0 ? reqs * 1000.0 / ms : 0.0, g_conns.v.n);
+#endif
 }
 
 static void parallel_dl(Vec<DLTask>& tasks, int nthreads = 16) {
     if (tasks.empty()) return;
-    volatile LONG cursor = 0, ndone = 0;
-    LONG total = (LONG)tasks.n;
-    DLThreadCtx ctx = { tasks.p, &cursor, &ndone, total };
-
-    int n = nthreads < (int)total ? nthreads : (int)total;
-    Vec<HANDLE> pool{};
-    pool.reserve((size_t)n);
-    for (int t = 0; t < n; ++t)
-        pool.push_back(CreateThread(nullptr, 0, dl_worker, &ctx, 0, nullptr));
+    DLRun run{};
+    dl_run_start(run, nthreads, tasks.n);
+    for (size_t i = 0; i < tasks.n; ++i) run.q.push(std::move(tasks.p[i]));
+    dl_run_finish(run);
+}
 
-    while (ndone < total) {
-        printf("  %ld/%ld\r", ndone, total);
+// ---- Background completion ---------------------------------------------------
+//
+// With early launch on, an install returns as soon as its critical tasks are
+// done. The rest of its run (asset objects) keeps going as the background
+// run, paced to g_bg_kbps and held at the concurrency floor so the game gets
+// the bandwidth. Anything that needs the whole install (verification,
+// another install, exiting from the menu) first waits for it at full speed;
+// exiting after a launch waits at the paced rate.
+
+inline bool g_early_launch = false;
+inline int  g_bg_kbps = 2048;   // 0 for no limit
+
+inline DLRun* g_bg_run = nullptr;
+
+// Reports progress until every critical task pushed so far is done.
+static void dl_run_wait_critical(DLRun& run) {
+    LONG total = run.q.pushed[DLP_CRITICAL];
+    while (run.ncrit_done < total) {
+        printf("  %ld/%ld\r", run.ncrit_done, total);
         fflush(stdout);
         Sleep(100);
     }
-    WaitForMultipleObjects((DWORD)pool.n, pool.p, TRUE, INFINITE);
-    for (size_t t = 0; t < pool.n; ++t) CloseHandle(pool.p[t]);
-    printf("  %ld/%ld\n", total, total);
+    if (total) printf("  %ld/%ld\n", total, total);
+}
+
+// Hands a run whose critical tasks are done over to the background.
+static void dl_run_detach(DLRun* run) {
+    run->q.close();
+    run->st.pace_bps = (LONG64)g_bg_kbps * 1024;
+    g_bg_run = run;
+}
+
+static void dl_background_wait(bool full_speed = true) {
+    DLRun* run = g_bg_run;
+    if (!run) return;
+    g_bg_run = nullptr;
+    if (full_speed) run->st.pace_bps = 0;
+    fputs("  Finishing background downloads...\n", stdout);
+    dl_run_finish(*run);
+    delete run;
 }
 
 struct Config {
@@ -696,6 +3006,11 @@ struct Config {
     int theme_color;
     bool hide_launcher;
     bool show_console;
+    bool verify_on_launch;
+    Str store_path;     // shared content store; empty when off
+    int dl_min, dl_max; // bounds on in-flight downloads
+    bool early_launch;  // play once launch-critical files are in
+    int bg_kbps;        // background download limit, 0 = none
 };
 
 static Config make_default_config() {
@@ -706,15 +3021,20 @@ static Config make_default_config() {
     c.theme_color = 7;
     c.hide_launcher = true;
     c.show_console = false;
+    c.verify_on_launch = false;
+    c.dl_min = 4;
+    c.dl_max = 96;
+    c.early_launch = false;
+    c.bg_kbps = 2048;
     return c;
 }
 
 static Str esc_json(const Str& s) {
     Str r{};
     for (size_t i = 0; i < s.n; ++i) {
-        if      (s.p[i] == '"')  { r.append_c('\\'); r.append_c('"'); }
-        else if (s.p[i] == '\\') { r.append_c('\\'); r.append_c('\\'); }
-        else r.append_c(s.p[i]);
+        if      (s.data()[i] == '"')  { r.append_c('\\'); r.append_c('"'); }
+        else if (s.data()[i] == '\\') { r.append_c('\\'); r.append_c('\\'); }
+        else r.append_c(s.data()[i]);
     }
     return r;
 }
@@ -722,17 +3042,29 @@ static Str esc_json(const Str& s) {
 static Config load_config(const WStr& path) {
     Config c = make_default_config();
     if (!path_exists(path)) return c;
-    Str s = read_file(path);
-    if (s.empty()) return c;
-    JVal j = parse_json(s);
+    JDoc doc = parse_json_file(path);
+    const JVal& j = doc.root;
     if (j.has("username"))    c.username.assign_s(j["username"].str());
     if (j.has("java_path"))   c.java_path.assign_s(j["java_path"].str());
     if (j.has("java_args"))   c.java_args.assign_s(j["java_args"].str());
-    if (j.has("ram_gb"))      c.ram_gb      = (int)j["ram_gb"].num();
-    if (j.has("theme_color")) c.theme_color = (int)j["theme_color"].num();
-    if (j.has("hide_launcher")) c.hide_launcher = j["hide_launcher"].bval;
-    if (j.has("show_console"))  c.show_console  = j["show_console"].bval;
+    if (j.has("ram_gb"))      c.ram_gb      = (int)j["ram_gb"].i64();
+    if (j.has("theme_color")) c.theme_color = (int)j["theme_color"].i64();
+    if (j.has("hide_launcher")) c.hide_launcher = j["hide_launcher"].boolean();
+    if (j.has("show_console"))  c.show_console  = j["show_console"].boolean();
+    if (j.has("verify_on_launch")) c.verify_on_launch = j["verify_on_launch"].boolean();
+    if (j.has("store_path"))  c.store_path.assign_s(j["store_path"].str());
+    if (j.has("dl_min"))      c.dl_min = (int)j["dl_min"].i64();
+    if (j.has("dl_max"))      c.dl_max = (int)j["dl_max"].i64();
+    if (j.has("early_launch")) c.early_launch = j["early_launch"].boolean();
+    if (j.has("bg_kbps"))     c.bg_kbps = (int)j["bg_kbps"].i64();
     if (c.ram_gb < 1) c.ram_gb = 1;
+    // Same bounds as the settings menu; each blocking worker has a 128 KB
+    // buffer on its stack.
+    if (c.dl_min < 1) c.dl_min = 1;
+    if (c.dl_min > 256) c.dl_min = 256;
+    if (c.dl_max < c.dl_min) c.dl_max = c.dl_min;
+    if (c.dl_max > 256) c.dl_max = 256;
+    if (c.bg_kbps < 0) c.bg_kbps = 0;
     return c;
 }
 
@@ -740,14 +3072,28 @@ static void save_config(const Config& c, const WStr& path) {
     Str eu = esc_json(c.username);
     Str ej = esc_json(c.java_path);
     Str ea = esc_json(c.java_args);
-    char buf[1024];
-    int n = snprintf(buf, sizeof(buf),
-        "{\n  \"username\": \"%s\",\n  \"java_path\": \"%s\","
-        "\n  \"java_args\": \"%s\",\n  \"ram_gb\": %d,\n  \"theme_color\": %d,"
-        "\n  \"hide_launcher\": %s,\n  \"show_console\": %s\n}\n",
-        eu.c_str(), ej.c_str(), ea.c_str(), c.ram_gb, c.theme_color,
-        c.hide_launcher ? "true" : "false", c.show_console ? "true" : "false");
-    if (n > 0) write_file(path, buf, (size_t)n);
+    Str es = esc_json(c.store_path);
+    // The strings are appended as they are, so their length is not bounded
+    // by a buffer; only the fixed-width fields go through snprintf.
+    char num[256];
+    Str o{};
+    o.append_s("{\n  \"username\": \"");  o.append(eu.data(), eu.n);
+    o.append_s("\",\n  \"java_path\": \""); o.append(ej.data(), ej.n);
+    o.append_s("\",\n  \"java_args\": \""); o.append(ea.data(), ea.n);
+    snprintf(num, sizeof(num),
+        "\",\n  \"ram_gb\": %d,\n  \"theme_color\": %d,"
+        "\n  \"hide_launcher\": %s,\n  \"show_console\": %s,\n  \"verify_on_launch\": %s,"
+        "\n  \"store_path\": \"",
+        c.ram_gb, c.theme_color,
+        c.hide_launcher ? "true" : "false", c.show_console ? "true" : "false",
+        c.verify_on_launch ? "true" : "false");
+    o.append_s(num); o.append(es.data(), es.n);
+    snprintf(num, sizeof(num),
+        "\",\n  \"dl_min\": %d,\n  \"dl_max\": %d,"
+        "\n  \"early_launch\": %s,\n  \"bg_kbps\": %d\n}\n",
+        c.dl_min, c.dl_max, c.early_launch ? "true" : "false", c.bg_kbps);
+    o.append_s(num);
+    write_file(path, o.data(), o.n);
 }
 
 inline int g_theme_color = 7;
@@ -760,7 +3106,7 @@ static void apply_theme() {
 static bool check_java(const Str& java) {
     Str cmd{};
     cmd.append_c('"');
-    cmd.append(java.p, java.n);
+    cmd.append(java.data(), java.n);
     cmd.append_s("\" -version > NUL 2>&1");
     return system(cmd.c_str()) == 0;
 }
@@ -809,11 +3155,11 @@ static const char* get_runtime_component(const char* mc) {
 static Str make_offline_uuid(const Str& name) {
     Str seed{};
     seed.assign_s("OfflinePlayer:");
-    seed.append(name.p, name.n);
+    seed.append(name.data(), name.n);
     uint8_t h[16]{};
     for (size_t i = 0; i < seed.n; ++i) {
-        h[i % 16]     ^= (uint8_t)((uint8_t)seed.p[i] * (uint8_t)(i + 1));
-        h[(i+3) % 16] += (uint8_t)seed.p[i];
+        h[i % 16]     ^= (uint8_t)((uint8_t)seed.data()[i] * (uint8_t)(i + 1));
+        h[(i+3) % 16] += (uint8_t)seed.data()[i];
     }
     h[6] = (h[6] & 0x0f) | 0x30;
     h[8] = (h[8] & 0x3f) | 0x80;
@@ -828,10 +3174,11 @@ static Str make_offline_uuid(const Str& name) {
 }
 
 static bool lib_applies(const JVal& lib) {
-    if (!lib.has("rules")) return true;
+    const JVal* rules = lib.find(JK_RULES);
+    if (!rules) return true;
     bool allowed = false;
-    for (size_t i = 0; i < lib["rules"].size(); ++i) {
-        const JVal& rule = lib["rules"].arr[i];
+    for (size_t i = 0; i < rules->size(); ++i) {
+        const JVal& rule = (*rules)[i];
         bool match = !rule.has("os") || !strcmp(rule["os"]["name"].str(), "windows");
         if (match) allowed = !strcmp(rule["action"].str(), "allow");
     }
@@ -890,22 +3237,22 @@ static Str maven_path(const char* coords) {
     }
 
     for (size_t i = 0; i < group.n; ++i)
-        if (group.p[i] == '.') group.p[i] = '/';
+        if (group.data()[i] == '.') group.data()[i] = '/';
 
     Str fname{};
-    fname.append(artifact.p, artifact.n);
+    fname.append(artifact.data(), artifact.n);
     fname.append_c('-');
-    fname.append(ver.p, ver.n);
-    if (!classifier.empty()) { fname.append_c('-'); fname.append(classifier.p, classifier.n); }
+    fname.append(ver.data(), ver.n);
+    if (!classifier.empty()) { fname.append_c('-'); fname.append(classifier.data(), classifier.n); }
     fname.append_s(".jar");
 
-    r.append(group.p, group.n);
+    r.append(group.data(), group.n);
     r.append_c('/');
-    r.append(artifact.p, artifact.n);
+    r.append(artifact.data(), artifact.n);
     r.append_c('/');
-    r.append(ver.p, ver.n);
+    r.append(ver.data(), ver.n);
     r.append_c('/');
-    r.append(fname.p, fname.n);
+    r.append(fname.data(), fname.n);
     return r;
 }
 
@@ -928,96 +3275,688 @@ inline constexpr const char* RUNTIME_ALL_URL =
     "2ec0cc96c44e5a76b9c8b7c39df7210883d12871/all.json";
 inline constexpr const char* FABRIC_META_BASE = "https://meta.fabricmc.net/v2/versions/";
 
+// Takes "sha1" and "size" from a download descriptor when it has them.
+static void dl_expect(DLTask& t, const JVal& d) {
+    if (const JVal* h = d.find(JK_SHA1)) t.sha1.assign_s(h->str());
+    if (const JVal* n = d.find(JK_SIZE)) t.size = n->i64();
+}
+
+// Native JARs (the ones extract_natives unpacks) get on_native as their
+// continuation when it is given.
 static void download_libraries_to_tasks(const WStr& root, const JVal& vj,
-                                         Vec<DLTask>& tasks) {
-    if (!vj.has("libraries")) return;
-    WStr lib_dir = pjoin(root, "libraries");
+                                         Vec<DLTask>& tasks,
+                                         DLThen on_native = nullptr, void* native_ctx = nullptr) {
+    const JVal* libs = vj.find(JK_LIBRARIES);
+    if (!libs) return;
+    PathBuf lib_dir(root);
+    lib_dir.add("libraries");
+    size_t lib_base = lib_dir.mark();
+
+    for (size_t i = 0; i < libs->size(); ++i) {
+        const JVal& lib = (*libs)[i];
+        if (!lib_applies(lib)) continue;
+        const JVal* dls = lib.find(JK_DOWNLOADS);
+
+        if (!dls && lib.has("name")) {
+            Str path = maven_path(lib["name"].str());
+            if (path.empty()) continue;
+            Str base_url{};
+            if (const JVal* u = lib.find(JK_URL)) base_url.assign_s(u->str());
+            else base_url.assign_s("https://libraries.minecraft.net/");
+            if (!base_url.empty() && base_url.back() != '/') base_url.append_c('/');
+            base_url.append(path.data(), path.n);
+            DLTask t{};
+            t.url = std::move(base_url);
+            lib_dir.reset(lib_base);
+            t.dest = lib_dir.add(path.c_str()).wstr();
+            dl_expect(t, lib);
+            tasks.push_back(std::move(t));
+            continue;
+        }
+
+        if (!dls) continue;
+
+        const JVal& nat = lib[JK_NATIVES];
+        if (nat.has("windows")) {
+            Str nat_cls{};
+            nat_cls.assign_s(nat["windows"].str());
+            const char* arch = sizeof(void*) == 8 ? "64" : "32";
+            size_t pos = nat_cls.find_s("${arch}");
+            if (pos != NPOS) nat_cls.replace_range(pos, 7, arch);
+
+            if (const JVal* a = (*dls)[JK_CLASSIFIERS].find(JKey(nat_cls.data(), nat_cls.n))) {
+                const char* u = (*a)[JK_URL].str();
+                const char* p = (*a)[JK_PATH].str();
+                if (u && *u && p && *p) {
+                    DLTask t{};
+                    t.url.assign_s(u);
+                    lib_dir.reset(lib_base);
+                    t.dest = lib_dir.add(p).wstr();
+                    dl_expect(t, *a);
+                    t.then = on_native;
+                    t.then_ctx = native_ctx;
+                    tasks.push_back(std::move(t));
+                }
+            }
+        }
+
+        if (const JVal* a = dls->find(JK_ARTIFACT)) {
+            const char* u = (*a)[JK_URL].str();
+            const char* p = (*a)[JK_PATH].str();
+            if (u && *u && p && *p) {
+                DLTask t{};
+                t.url.assign_s(u);
+                lib_dir.reset(lib_base);
+                t.dest = lib_dir.add(p).wstr();
+                dl_expect(t, *a);
+                if (!nat.has("windows") && is_native_artifact_path(p) && native_path_matches_arch(p)) {
+                    t.then = on_native;
+                    t.then_ctx = native_ctx;
+                }
+                tasks.push_back(std::move(t));
+            }
+        }
+    }
+}
+
+// ---- ZIP extraction ----------------------------------------------------------
+//
+// Native JARs are unpacked in-process. The central directory is read from a
+// mapped view of the archive, and each entry (stored, or raw DEFLATE) is
+// decoded straight into a buffer of its declared size and checked against its
+// CRC-32 before being written out.
+
+// Huffman codes of at most INFL_FAST_BITS bits decode with one table lookup;
+// longer ones fall back to a canonical walk.
+inline constexpr int INFL_FAST_BITS = 10;
+
+struct InflHuff {
+    uint16_t fast[1 << INFL_FAST_BITS];  // (len << 9) | symbol, 0 if longer
+    uint16_t count[16];
+    uint16_t sym[320];
+};
+
+struct InflState {
+    const uint8_t* p;
+    const uint8_t* end;
+    uint64_t       bits;
+    int            nbits;
+    uint8_t*       out;
+    size_t         pos, cap;
+
+    void refill() {
+        while (nbits <= 56 && p < end) { bits |= (uint64_t)*p++ << nbits; nbits += 8; }
+    }
+    // false when the input has run out.
+    bool need(int n) {
+        if (nbits < n) refill();
+        return nbits >= n;
+    }
+    uint32_t take(int n) {
+        uint32_t v = (uint32_t)(bits & ((1ull << n) - 1));
+        bits >>= n; nbits -= n;
+        return v;
+    }
+};
+
+// Builds the decoding tables for n code lengths; false if they over-subscribe
+// the code space. Incomplete codes are allowed (a lone distance code is).
+static bool infl_build(InflHuff& h, const uint8_t* len, int n) {
+    memset(h.count, 0, sizeof(h.count));
+    for (int i = 0; i < n; ++i) ++h.count[len[i]];
+    h.count[0] = 0;
+    int left = 1;
+    for (int l = 1; l < 16; ++l) {
+        left = (left << 1) - h.count[l];
+        if (left < 0) return false;
+    }
+    uint16_t offs[16];
+    offs[1] = 0;
+    for (int l = 1; l < 15; ++l) offs[l + 1] = offs[l] + h.count[l];
+    for (int i = 0; i < n; ++i) if (len[i]) h.sym[offs[len[i]]++] = (uint16_t)i;
+
+    memset(h.fast, 0, sizeof(h.fast));
+    uint32_t code = 0;
+    size_t k = 0;
+    for (int l = 1; l <= INFL_FAST_BITS; ++l) {
+        for (int c = 0; c < h.count[l]; ++c, ++code, ++k) {
+            uint32_t r = 0;
+            for (int b = 0; b < l; ++b) r |= ((code >> b) & 1) << (l - 1 - b);
+            for (uint32_t j = r; j < (1u << INFL_FAST_BITS); j += 1u << l)
+                h.fast[j] = (uint16_t)((l << 9) | h.sym[k]);
+        }
+        code <<= 1;
+    }
+    return true;
+}
+
+// Next symbol, or -1 on bad or truncated input.
+static int infl_decode(InflState& s, const InflHuff& h) {
+    if (s.need(INFL_FAST_BITS)) {
+        uint16_t e = h.fast[s.bits & ((1u << INFL_FAST_BITS) - 1)];
+        if (e) { s.take(e >> 9); return e & 511; }
+    }
+    int code = 0, first = 0, index = 0;
+    for (int l = 1; l < 16; ++l) {
+        if (!s.need(l)) return -1;
+        code |= (int)((s.bits >> (l - 1)) & 1);
+        int count = h.count[l];
+        if (code - first < count) { s.take(l); return h.sym[index + code - first]; }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+inline constexpr uint16_t INFL_LEN_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+inline constexpr uint8_t INFL_LEN_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+inline constexpr uint16_t INFL_DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+inline constexpr uint8_t INFL_DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static bool infl_codes(InflState& s, const InflHuff& lit, const InflHuff& dist) {
+    for (;;) {
+        int sym = infl_decode(s, lit);
+        if (sym < 0) return false;
+        if (sym < 256) {
+            if (s.pos == s.cap) return false;
+            s.out[s.pos++] = (uint8_t)sym;
+            continue;
+        }
+        if (sym == 256) return true;
+        sym -= 257;
+        if (sym >= 29) return false;
+        int e = INFL_LEN_EXTRA[sym];
+        if (!s.need(e)) return false;
+        size_t len = INFL_LEN_BASE[sym] + s.take(e);
+        int ds = infl_decode(s, dist);
+        if (ds < 0 || ds >= 30) return false;
+        e = INFL_DIST_EXTRA[ds];
+        if (!s.need(e)) return false;
+        size_t d = INFL_DIST_BASE[ds] + s.take(e);
+        if (d > s.pos || len > s.cap - s.pos) return false;
+        uint8_t* o = s.out + s.pos;
+        const uint8_t* from = o - d;
+        if (d >= len) memcpy(o, from, len);
+        else for (size_t i = 0; i < len; ++i) o[i] = from[i];
+        s.pos += len;
+    }
+}
+
+static bool infl_stored(InflState& s) {
+    // Back up to the byte boundary; whole bytes still in the bit buffer are
+    // returned to the input.
+    s.take(s.nbits & 7);
+    s.p -= s.nbits / 8;
+    s.bits = 0; s.nbits = 0;
+    if (s.end - s.p < 4) return false;
+    size_t len  = s.p[0] | (s.p[1] << 8);
+    size_t nlen = s.p[2] | (s.p[3] << 8);
+    s.p += 4;
+    if (len != (~nlen & 0xffff)) return false;
+    if ((size_t)(s.end - s.p) < len || len > s.cap - s.pos) return false;
+    memcpy(s.out + s.pos, s.p, len);
+    s.p += len;
+    s.pos += len;
+    return true;
+}
+
+struct InflFixed { InflHuff lit, dist; };
+
+static InflFixed* make_infl_fixed() {
+    InflFixed* f = new InflFixed;
+    uint8_t len[288];
+    int i = 0;
+    for (; i < 144; ++i) len[i] = 8;
+    for (; i < 256; ++i) len[i] = 9;
+    for (; i < 280; ++i) len[i] = 7;
+    for (; i < 288; ++i) len[i] = 8;
+    infl_build(f->lit, len, 288);
+    for (i = 0; i < 30; ++i) len[i] = 5;
+    infl_build(f->dist, len, 30);
+    return f;
+}
+
+static bool infl_dynamic(InflState& s, InflHuff* t) {
+    static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+    if (!s.need(14)) return false;
+    int nlen  = (int)s.take(5) + 257;
+    int ndist = (int)s.take(5) + 1;
+    int ncode = (int)s.take(4) + 4;
+    if (nlen > 286 || ndist > 30) return false;
+
+    uint8_t len[320] = {};
+    for (int i = 0; i < ncode; ++i) {
+        if (!s.need(3)) return false;
+        len[order[i]] = (uint8_t)s.take(3);
+    }
+    if (!infl_build(t[0], len, 19)) return false;
+
+    int i = 0;
+    memset(len, 0, sizeof(len));
+    while (i < nlen + ndist) {
+        int sym = infl_decode(s, t[0]);
+        if (sym < 0) return false;
+        if (sym < 16) { len[i++] = (uint8_t)sym; continue; }
+        uint8_t v = 0;
+        int rep;
+        if (sym == 16) {
+            if (!i || !s.need(2)) return false;
+            v = len[i - 1];
+            rep = 3 + (int)s.take(2);
+        } else if (sym == 17) {
+            if (!s.need(3)) return false;
+            rep = 3 + (int)s.take(3);
+        } else {
+            if (!s.need(7)) return false;
+            rep = 11 + (int)s.take(7);
+        }
+        if (i + rep > nlen + ndist) return false;
+        while (rep--) len[i++] = v;
+    }
+    if (!len[256]) return false;
+    return infl_build(t[0], len, nlen) && infl_build(t[1], len + nlen, ndist);
+}
+
+// Decodes a raw DEFLATE stream into out, which must hold exactly cap bytes.
+static bool inflate_raw(const uint8_t* in, size_t n, uint8_t* out, size_t cap) {
+    InflState s{ in, in + n, 0, 0, out, 0, cap };
+    InflHuff* dyn = (InflHuff*)malloc(2 * sizeof(InflHuff));
+    if (!dyn) return false;
+    bool ok = true, last = false;
+    while (ok && !last) {
+        if (!s.need(3)) { ok = false; break; }
+        last = s.take(1) != 0;
+        switch (s.take(2)) {
+        case 0:  ok = infl_stored(s); break;
+        case 1:  { static const InflFixed* f = make_infl_fixed(); ok = infl_codes(s, f->lit, f->dist); } break;
+        case 2:  ok = infl_dynamic(s, dyn) && infl_codes(s, dyn[0], dyn[1]); break;
+        default: ok = false;
+        }
+    }
+    free(dyn);
+    return ok && s.pos == cap;
+}
+
+struct Crc32Table { uint32_t t[8][256]; };
+
+static Crc32Table* make_crc32_table() {
+    Crc32Table* k = new Crc32Table;
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int b = 0; b < 8; ++b) c = (c >> 1) ^ (0xEDB88320u & (0u - (c & 1)));
+        k->t[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; ++i)
+        for (int j = 1; j < 8; ++j)
+            k->t[j][i] = (k->t[j - 1][i] >> 8) ^ k->t[0][k->t[j - 1][i] & 0xff];
+    return k;
+}
+
+// Slicing-by-8.
+static uint32_t crc32_buf(const uint8_t* p, size_t n) {
+    static const Crc32Table* tab = make_crc32_table();
+    const uint32_t (*t)[256] = tab->t;
+    uint32_t c = 0xFFFFFFFFu;
+    for (; n >= 8; p += 8, n -= 8) {
+        uint32_t a = c ^ (p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24));
+        c = t[7][a & 0xff] ^ t[6][(a >> 8) & 0xff] ^ t[5][(a >> 16) & 0xff] ^
+            t[4][a >> 24] ^ t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+    }
+    while (n--) c = (c >> 8) ^ t[0][(c ^ *p++) & 0xff];
+    return ~c;
+}
+
+static uint16_t rd16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t rd32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+struct ZipEntry {
+    const char*    name;
+    size_t         nlen;
+    uint16_t       method;  // 0 stored, 8 deflate
+    uint32_t       crc;
+    const uint8_t* data;
+    size_t         csize, usize;
+};
+
+typedef bool (*ZipEntryFn)(void* ctx, const ZipEntry& e);
+
+// Calls fn for every entry of the archive in z[0..n), in directory order;
+// false if the archive is malformed (ZIP64 is not supported) or fn stops.
+static bool zip_for_each(const uint8_t* z, size_t n, ZipEntryFn fn, void* ctx) {
+    if (n < 22) return false;
+    // The end record sits behind a comment of up to 64 KB.
+    size_t lo = n > 22 + 65535 ? n - 22 - 65535 : 0;
+    size_t eocd = n - 22;
+    while (rd32(z + eocd) != 0x06054b50)
+        if (eocd-- == lo) return false;
+    size_t count = rd16(z + eocd + 10);
+    size_t cd    = rd32(z + eocd + 16);
+    for (size_t i = 0; i < count; ++i) {
+        if (cd > n || n - cd < 46 || rd32(z + cd) != 0x02014b50) return false;
+        const uint8_t* c = z + cd;
+        ZipEntry e{};
+        e.method = rd16(c + 10);
+        e.crc    = rd32(c + 16);
+        e.csize  = rd32(c + 20);
+        e.usize  = rd32(c + 24);
+        e.nlen   = rd16(c + 28);
+        size_t extra = rd16(c + 30), comment = rd16(c + 32);
+        size_t loc   = rd32(c + 42);
+        if (n - cd - 46 < e.nlen) return false;
+        e.name = (const char*)c + 46;
+        if (loc > n || n - loc < 30 || rd32(z + loc) != 0x04034b50) return false;
+        size_t data = loc + 30 + rd16(z + loc + 26) + rd16(z + loc + 28);
+        if (data > n || n - data < e.csize) return false;
+        e.data = z + data;
+        if (!fn(ctx, e)) return false;
+        cd += 46 + e.nlen + extra + comment;
+    }
+    return true;
+}
+
+// Decodes an entry into out (usize bytes) and checks its CRC.
+static bool zip_entry_data(const ZipEntry& e, uint8_t* out) {
+    if (e.method == 0) {
+        if (e.csize != e.usize) return false;
+        memcpy(out, e.data, e.usize);
+    } else if (e.method == 8) {
+        if (!inflate_raw(e.data, e.csize, out, e.usize)) return false;
+    } else {
+        return false;
+    }
+    return crc32_buf(out, e.usize) == e.crc;
+}
+
+// Mirrors tar --exclude=META-INF (any path with a META-INF component) and
+// refuses names that could land outside the target directory.
+static bool zip_name_extractable(const char* s, size_t n) {
+    if (!n || s[0] == '/' || s[0] == '\\') return false;
+    size_t b = 0;
+    for (size_t i = 0; i <= n; ++i) {
+        if (i < n && s[i] != '/' && s[i] != '\\') {
+            if (s[i] == ':') return false;
+            continue;
+        }
+        size_t len = i - b;
+        if (len == 2 && s[b] == '.' && s[b + 1] == '.') return false;
+        if (len == 8 && !memcmp(s + b, "META-INF", 8)) return false;
+        b = i + 1;
+    }
+    return true;
+}
+
+struct UnzipCtx { PathBuf* out; size_t base; int files; bool ok; Vec<Str>* names; };
+
+static bool unzip_entry(void* ctx, const ZipEntry& e) {
+    UnzipCtx& u = *(UnzipCtx*)ctx;
+    if (!zip_name_extractable(e.name, e.nlen)) return true;
+    PathBuf& out = *u.out;
+    out.reset(u.base);
+    out.sep().append(e.name, e.nlen);
+    for (size_t i = u.base; i < out.n; ++i) if (out.p[i] == L'/') out.p[i] = L'\\';
+    if (e.name[e.nlen - 1] == '/') { create_dirs(out.wstr()); return true; }
+
+    uint8_t* buf = (uint8_t*)malloc(e.usize ? e.usize : 1);
+    bool ok = buf && zip_entry_data(e, buf);
+    if (ok) {
+        if (memchr(e.name, '/', e.nlen)) make_parent_dirs(out.wstr());
+        HANDLE h = CreateFileW(out.c_str(), GENERIC_WRITE, 0, nullptr,
+                               CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        DWORD wr = 0;
+        ok = h != INVALID_HANDLE_VALUE &&
+             WriteFile(h, buf, (DWORD)e.usize, &wr, nullptr) && wr == e.usize;
+        if (h != INVALID_HANDLE_VALUE) CloseHandle(h);
+    }
+    free(buf);
+    // A bad entry is reported but does not stop the rest.
+    if (!ok) { u.ok = false; return true; }
+    ++u.files;
+    if (u.names) { Str nm{}; nm.assign(e.name, e.nlen); u.names->push_back(std::move(nm)); }
+    return true;
+}
+
+// Extracts the archive at zip into dir, adding the entry names of the files
+// written to names when given. Returns the number of files written, or -1 if
+// the archive could not be read or any entry failed.
+static int unzip_to_dir(const WStr& zip, const WStr& dir, Vec<Str>* names = nullptr) {
+    MappedFile mf;
+    // Without ZIP64 an archive cannot pass 4 GB.
+    if (!mf.open(zip) || (unsigned long long)mf.n > 0xFFFFFFFFull) return -1;
+    PathBuf out(dir);
+    UnzipCtx u{ &out, out.mark(), 0, true, names };
+    bool ok = zip_for_each((const uint8_t*)mf.p, mf.n, unzip_entry, &u);
+    return ok && u.ok ? u.files : -1;
+}
+
+static WStr natives_dir(const WStr& root, const char* version) {
+    return pjoin(pjoin(pjoin(root, "versions"), version), "natives");
+}
+
+// natives/.natives.json records every JAR extracted into the directory by
+// size and last-write time, with the files it produced. A JAR whose stamp
+// matches and whose files are all still there is not extracted again, and
+// files of JARs that are no longer part of the install are removed.
+struct NatEntry {
+    Str      jar;
+    uint64_t size, mtime;
+    Vec<Str> files;
+    bool     used;
+};
+
+// Native JARs queued on an install run are unpacked as each one lands;
+// extract_natives hands its list of JARs to one worker per CPU instead.
+struct NativesJob {
+    WStr            nat_dir;
+    volatile LONG   extracted, files, unchanged;
+    volatile LONG64 us;         // summed extraction time
+    Vec<WStr>       jars;
+    volatile LONG   next;
+    SRWLOCK         lock;       // guards man
+    Vec<NatEntry>   man;
+};
+
+static WStr natives_manifest_path(const WStr& nat_dir) { return pjoin(nat_dir, ".natives.json"); }
+
+static void natives_file_path(PathBuf& pb, const WStr& nat_dir, const Str& name) {
+    pb.reset(0);
+    pb.append_w(nat_dir.c_str(), nat_dir.n);
+    size_t base = pb.sep().mark();
+    pb.append(name.data(), name.n);
+    for (size_t i = base; i < pb.n; ++i) if (pb.p[i] == L'/') pb.p[i] = L'\\';
+}
 
-    for (size_t i = 0; i < vj["libraries"].arr_n; ++i) {
-        const JVal& lib = vj["libraries"].arr[i];
-        if (!lib_applies(lib)) continue;
+static void natives_load(NativesJob& j) {
+    j.lock = SRWLOCK_INIT;
+    WStr mp = natives_manifest_path(j.nat_dir);
+    if (!path_exists(mp)) return;
+    JDoc doc = parse_json_file(mp);
+    const JVal& jars = doc.root["jars"];
+    for (size_t i = 0; i < jars.size(); ++i) {
+        const JVal& e = jars[i];
+        NatEntry n{};
+        n.jar.assign_s(e["jar"].str());
+        n.size  = (uint64_t)e["size"].i64();
+        n.mtime = (uint64_t)e["mtime"].i64();
+        const JVal& f = e["files"];
+        for (size_t k = 0; k < f.size(); ++k) { Str nm{}; nm.assign_s(f[k].str()); n.files.push_back(std::move(nm)); }
+        j.man.push_back(std::move(n));
+    }
+}
 
-        if (lib.has("name") && !lib.has("downloads")) {
-            Str path = maven_path(lib["name"].str());
-            if (path.empty()) continue;
-            Str base_url{};
-            if (lib.has("url")) base_url.assign_s(lib["url"].str());
-            else base_url.assign_s("https://libraries.minecraft.net/");
-            if (!base_url.empty() && base_url.back() != '/') base_url.append_c('/');
-            base_url.append(path.p, path.n);
-            DLTask t{};
-            t.url = std::move(base_url);
-            t.dest = pjoin(lib_dir, path.c_str());
-            tasks.push_back(std::move(t));
-            continue;
+static size_t natives_find(const NativesJob& j, const Str& jar) {
+    size_t i = 0;
+    while (i < j.man.n && !j.man.p[i].jar.eq(jar.c_str())) ++i;
+    return i;
+}
+
+// Whether jar, as stamped, already has all its files in the directory.
+static bool natives_unchanged(NativesJob& j, const Str& jar, uint64_t size, uint64_t mtime) {
+    PathBuf pb;
+    bool r = false;
+    AcquireSRWLockExclusive(&j.lock);
+    size_t i = natives_find(j, jar);
+    if (i < j.man.n) {
+        NatEntry& e = j.man.p[i];
+        r = e.size == size && e.mtime == mtime;
+        for (size_t k = 0; r && k < e.files.n; ++k) {
+            natives_file_path(pb, j.nat_dir, e.files.p[k]);
+            r = path_file_size_w(pb.c_str()) >= 0;
         }
+        if (r) e.used = true;
+    }
+    ReleaseSRWLockExclusive(&j.lock);
+    return r;
+}
 
-        if (!lib.has("downloads")) continue;
+// A JAR that failed to arrive keeps whatever it extracted before.
+static void natives_keep(NativesJob& j, const Str& jar) {
+    AcquireSRWLockExclusive(&j.lock);
+    size_t i = natives_find(j, jar);
+    if (i < j.man.n) j.man.p[i].used = true;
+    ReleaseSRWLockExclusive(&j.lock);
+}
 
-        if (lib.has("natives") && lib["natives"].has("windows")) {
-            Str nat_cls{};
-            nat_cls.assign_s(lib["natives"]["windows"].str());
-            const char* arch = sizeof(void*) == 8 ? "64" : "32";
-            size_t pos = nat_cls.find_s("${arch}");
-            if (pos != NPOS) nat_cls.replace_range(pos, 7, arch);
+// Files the JAR's previous version produced and this one did not are removed.
+static void natives_record(NativesJob& j, Str&& jar, uint64_t size, uint64_t mtime, Vec<Str>&& files) {
+    PathBuf pb;
+    AcquireSRWLockExclusive(&j.lock);
+    size_t i = natives_find(j, jar);
+    if (i == j.man.n) j.man.push_back(NatEntry{});
+    NatEntry& e = j.man.p[i];
+    for (size_t k = 0; k < e.files.n; ++k) {
+        bool kept = false;
+        for (size_t m = 0; m < files.n && !kept; ++m) kept = files.p[m].eq(e.files.p[k].c_str());
+        if (kept) continue;
+        natives_file_path(pb, j.nat_dir, e.files.p[k]);
+        DeleteFileW(pb.c_str());
+    }
+    e.jar   = std::move(jar);
+    e.size  = size;
+    e.mtime = mtime;
+    e.files = std::move(files);
+    e.used  = true;
+    ReleaseSRWLockExclusive(&j.lock);
+}
 
-            if (lib["downloads"].has("classifiers") &&
-                lib["downloads"]["classifiers"].has(nat_cls.c_str())) {
-                const JVal& a = lib["downloads"]["classifiers"][nat_cls.c_str()];
-                const char* u = a["url"].str();
-                const char* p = a["path"].str();
-                if (u && *u && p && *p) {
-                    DLTask t{};
-                    t.url.assign_s(u);
-                    t.dest = pjoin(lib_dir, p);
-                    tasks.push_back(std::move(t));
-                }
+// Removes the files of JARs this run did not touch (unless a current JAR
+// produced the same file) and writes the manifest back.
+static void natives_finish(NativesJob& j) {
+    PathBuf pb;
+    Vec<NatEntry> keep{};
+    for (size_t i = 0; i < j.man.n; ++i) {
+        NatEntry& e = j.man.p[i];
+        if (e.used) { keep.push_back(std::move(e)); continue; }
+        for (size_t k = 0; k < e.files.n; ++k) {
+            bool shared = false;
+            for (size_t u = 0; u < j.man.n && !shared; ++u) {
+                if (!j.man.p[u].used) continue;
+                const Vec<Str>& f = j.man.p[u].files;
+                for (size_t m = 0; m < f.n && !shared; ++m) shared = f.p[m].eq(e.files.p[k].c_str());
             }
+            if (shared) continue;
+            natives_file_path(pb, j.nat_dir, e.files.p[k]);
+            DeleteFileW(pb.c_str());
         }
-
-        if (lib["downloads"].has("artifact")) {
-            const JVal& a = lib["downloads"]["artifact"];
-            const char* u = a["url"].str();
-            const char* p = a["path"].str();
-            if (u && *u && p && *p) {
-                DLTask t{};
-                t.url.assign_s(u);
-                t.dest = pjoin(lib_dir, p);
-                tasks.push_back(std::move(t));
-            }
+    }
+    j.man = std::move(keep);
+
+    Str out{};
+    out.append_s("{\n  \"jars\": [");
+    for (size_t i = 0; i < j.man.n; ++i) {
+        const NatEntry& e = j.man.p[i];
+        Str ej = esc_json(e.jar);
+        char num[64];
+        snprintf(num, sizeof(num), "\", \"size\": %llu, \"mtime\": %llu, \"files\": [",
+                 (unsigned long long)e.size, (unsigned long long)e.mtime);
+        out.append_s(i ? ",\n    {\"jar\": \"" : "\n    {\"jar\": \"");
+        out.append(ej.data(), ej.n);
+        out.append_s(num);
+        for (size_t k = 0; k < e.files.n; ++k) {
+            Str ef = esc_json(e.files.p[k]);
+            out.append_s(k ? ", \"" : "\"");
+            out.append(ef.data(), ef.n);
+            out.append_c('"');
         }
+        out.append_s("]}");
     }
+    out.append_s("\n  ]\n}\n");
+    write_file(natives_manifest_path(j.nat_dir), out.c_str(), out.n);
 }
 
-static void extract_natives(const WStr& root, const char* version, const JVal& vj) {
-    if (!vj.has("libraries")) return;
-    WStr lib_dir = pjoin(root, "libraries");
-    WStr nat_dir = pjoin(pjoin(pjoin(root, "versions"), version), "natives");
-    create_dirs(nat_dir);
+static void natives_on_jar(void* ctx, const WStr& jar, bool ok) {
+    NativesJob* j = (NativesJob*)ctx;
+    Str key = path_to_str(jar);
+    if (!ok) {
+        fprintf(stderr, "  [natives] JAR missing: %s\n", key.c_str());
+        natives_keep(*j, key);
+        return;
+    }
+    uint64_t size = 0, mtime = 0;
+    file_stamp(jar, &size, &mtime);
+    if (natives_unchanged(*j, key, size, mtime)) { InterlockedIncrement(&j->unchanged); return; }
+
+    double t0 = now_ms();
+    Vec<Str> names{};
+    int n = unzip_to_dir(jar, j->nat_dir, &names);
+    InterlockedExchangeAdd64(&j->us, (LONG64)((now_ms() - t0) * 1000.0));
+    if (n < 0) {
+        fprintf(stderr, "  [natives] Could not extract: %s\n", key.c_str());
+        natives_keep(*j, key);
+        return;
+    }
+    natives_record(*j, std::move(key), size, mtime, std::move(names));
+    InterlockedIncrement(&j->extracted);
+    InterlockedExchangeAdd(&j->files, n);
+}
+
+static DWORD WINAPI natives_worker(LPVOID arg) {
+    NativesJob* j = (NativesJob*)arg;
+    for (LONG i; (i = InterlockedIncrement(&j->next) - 1) < (LONG)j->jars.n; )
+        natives_on_jar(j, j->jars.p[i], true);
+    return 0;
+}
+
+static void natives_report(const NativesJob& j) {
+    Str ns = path_to_str(j.nat_dir);
+    printf("  Extracted %ld native JAR(s), %ld files in %.0f ms (%ld unchanged) -> %s\n",
+           j.extracted, j.files, j.us / 1000.0, j.unchanged, ns.c_str());
+}
 
-    int extracted = 0;
-    for (size_t i = 0; i < vj["libraries"].arr_n; ++i) {
-        const JVal& lib = vj["libraries"].arr[i];
+static void natives_collect(const WStr& lib_dir, const JVal& vj, Vec<WStr>& jars) {
+    const JVal* libs = vj.find(JK_LIBRARIES);
+    if (!libs) return;
+    for (size_t i = 0; i < libs->size(); ++i) {
+        const JVal& lib = (*libs)[i];
         if (!lib_applies(lib)) continue;
 
         WStr jar_path{};
+        const JVal& dls = lib[JK_DOWNLOADS];
+        const JVal& nat = lib[JK_NATIVES];
 
-        if (lib.has("natives") && lib["natives"].has("windows")) {
+        if (nat.has("windows")) {
             Str nat_cls{};
-            nat_cls.assign_s(lib["natives"]["windows"].str());
+            nat_cls.assign_s(nat["windows"].str());
             const char* arch = sizeof(void*) == 8 ? "64" : "32";
             size_t pos = nat_cls.find_s("${arch}");
             if (pos != NPOS) nat_cls.replace_range(pos, 7, arch);
 
-            if (!lib.has("downloads") ||
-                !lib["downloads"].has("classifiers") ||
-                !lib["downloads"]["classifiers"].has(nat_cls.c_str())) continue;
+            const JVal* a = dls[JK_CLASSIFIERS].find(JKey(nat_cls.data(), nat_cls.n));
+            if (!a) continue;
 
-            const char* p = lib["downloads"]["classifiers"][nat_cls.c_str()]["path"].str();
+            const char* p = (*a)[JK_PATH].str();
             if (!p || !*p) continue;
             jar_path = pjoin(lib_dir, p);
-        } else if (lib.has("downloads") && lib["downloads"].has("artifact")) {
-            const char* p = lib["downloads"]["artifact"]["path"].str();
+        } else if (const JVal* a = dls.find(JK_ARTIFACT)) {
+            const char* p = (*a)[JK_PATH].str();
             if (!is_native_artifact_path(p)) continue;
             if (!native_path_matches_arch(p)) continue;
             jar_path = pjoin(lib_dir, p);
@@ -1031,29 +3970,340 @@ static void extract_natives(const WStr& root, const char* version, const JVal& v
             continue;
         }
 
-        Str jar_s = path_to_str(jar_path);
-        Str nat_s = path_to_str(nat_dir);
-        char cmd[8192];
-        snprintf(cmd, sizeof(cmd),
-            "tar -xf \"%s\" -C \"%s\" --exclude=META-INF 2>NUL",
-            jar_s.c_str(), nat_s.c_str());
-        system(cmd);
-        ++extracted;
+        bool dup = false;
+        for (size_t k = 0; k < jars.n && !dup; ++k) dup = !wcscmp(jars.p[k].c_str(), jar_path.c_str());
+        if (!dup) jars.push_back(std::move(jar_path));
     }
+}
 
-    Str nat_s = path_to_str(nat_dir);
-    printf("  Extracted %d native JAR(s) -> %s\n", extracted, nat_s.c_str());
+// Extracts the natives of vj, and of a profile layered on it when given, into
+// the version's natives directory. Both must be passed together: the natives
+// manifest drops the files of any JAR not extracted by this call.
+static void extract_natives(const WStr& root, const char* version, const JVal& vj,
+                            const JVal* profile = nullptr) {
+    WStr lib_dir = pjoin(root, "libraries");
+    NativesJob job{};
+    job.nat_dir = natives_dir(root, version);
+    create_dirs(job.nat_dir);
+    natives_collect(lib_dir, vj, job.jars);
+    if (profile) natives_collect(lib_dir, *profile, job.jars);
+    natives_load(job);
+
+    SYSTEM_INFO si{};
+    GetSystemInfo(&si);
+    size_t nthreads = si.dwNumberOfProcessors ? si.dwNumberOfProcessors : 1;
+    if (nthreads > MAXIMUM_WAIT_OBJECTS) nthreads = MAXIMUM_WAIT_OBJECTS;
+    if (nthreads > job.jars.n) nthreads = job.jars.n;
+    Vec<HANDLE> pool{};
+    pool.reserve(nthreads);
+    for (size_t t = 0; t < nthreads; ++t)
+        pool.push_back(CreateThread(nullptr, 0, natives_worker, &job, 0, nullptr));
+    if (pool.n) WaitForMultipleObjects((DWORD)pool.n, pool.p, TRUE, INFINITE);
+    for (size_t t = 0; t < pool.n; ++t) CloseHandle(pool.p[t]);
+    natives_finish(job);
+    natives_report(job);
 }
 
 static bool lib_is_native_only(const JVal& lib) {
-    if (lib.has("natives") && lib["natives"].has("windows")) return true;
-    if (lib.has("downloads") && lib["downloads"].has("artifact")) {
-        const char* p = lib["downloads"]["artifact"]["path"].str();
+    if (lib[JK_NATIVES].has("windows")) return true;
+    if (const JVal* a = lib[JK_DOWNLOADS].find(JK_ARTIFACT)) {
+        const char* p = (*a)[JK_PATH].str();
         if (is_native_artifact_path(p)) return true;
     }
     return false;
 }
 
+// Tees streamed index bytes into an optional on-disk cache and the reader.
+struct SaxFeed { JSax* sx; HANDLE cache; };
+
+static bool sax_feed_chunk(void* ctx, const char* p, size_t n) {
+    SaxFeed* f = (SaxFeed*)ctx;
+    if (f->cache != INVALID_HANDLE_VALUE) {
+        DWORD wr = 0;
+        if (!WriteFile(f->cache, p, (DWORD)n, &wr, nullptr) || wr != n) return false;
+    }
+    f->sx->feed(p, n);
+    return true;
+}
+
+// With plan set, every entry is appended there instead of being queued on
+// run; that is how the verifier collects what an install should contain.
+struct JreSink {
+    const WStr* jre_dir;
+    DLRun*      run;
+    Vec<DLTask>* plan;
+    Str         type, url, sha1;
+    int64_t     size;
+    size_t      nfiles;
+    int64_t     bytes;
+};
+
+// Integer value of a streamed number token (0 if it is not an exact integer).
+static int64_t sax_i64(const char* s) {
+    int64_t iv = 0; double dv;
+    return parse_json_num(s, &iv, &dv) ? iv : 0;
+}
+
+// files > <path> > { "type", "downloads" > "raw" > { "url", "sha1", "size" } }
+static void jre_manifest_event(void* ctx, JSax& sx, JSaxEv ev, const char* s, size_t n) {
+    JreSink& k = *(JreSink*)ctx;
+    if (!sx.key_is(0, "files")) return;
+    if (sx.depth == 2 && ev == JS_OBJ_BEGIN) {
+        k.type.clear(); k.url.clear(); k.sha1.clear(); k.size = 0;
+    } else if (sx.depth == 3 && ev == JS_STR && sx.key_is(2, "type")) {
+        k.type.assign(s, n);
+    } else if (sx.depth == 5 && ev == JS_STR && sx.key_is(2, "downloads") &&
+               sx.key_is(3, "raw") && sx.key_is(4, "url")) {
+        k.url.assign(s, n);
+    } else if (sx.depth == 5 && ev == JS_STR && sx.key_is(2, "downloads") &&
+               sx.key_is(3, "raw") && sx.key_is(4, "sha1")) {
+        k.sha1.assign(s, n);
+    } else if (sx.depth == 5 && ev == JS_NUM && sx.key_is(2, "downloads") &&
+               sx.key_is(3, "raw") && sx.key_is(4, "size")) {
+        k.size = sax_i64(s);
+    } else if (sx.depth == 2 && ev == JS_OBJ_END) {
+        WStr rel = pjoin(*k.jre_dir, sx.key[1].c_str());
+        if (k.type.eq("directory")) {
+            create_dirs(rel);
+        } else if (k.type.eq("file") && !k.url.empty()) {
+            DLTask t{};
+            t.url.copy_from(k.url);
+            t.dest = std::move(rel);
+            t.sha1.copy_from(k.sha1);
+            t.size = k.size;
+            if (k.plan) k.plan->push_back(std::move(t));
+            else        k.run->q.push(std::move(t));
+            ++k.nfiles;
+            k.bytes += k.size;
+        }
+    }
+}
+
+// ---- Cached asset objects ----------------------------------------------------
+//
+// Before an asset index is planned, each of the 256 objects/xx directories is
+// listed once, spread over several threads, into a table of object -> size.
+// Deciding which objects are already present then costs 256 directory reads
+// instead of one attribute call per object.
+
+// An object is named by its 40-digit SHA-1; its first 16 digits key it.
+// 0 for any other name (.part files and the like).
+template <class C>
+static uint64_t obj_key(const C* s, size_t n) {
+    if (n != 40) return 0;
+    uint64_t k = 0;
+    for (size_t i = 0; i < 16; ++i) {
+        C c = s[i];
+        int v = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10
+              : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (v < 0) return 0;
+        k = k << 4 | (uint64_t)v;
+    }
+    return k ? k : 1;
+}
+
+// Open-addressed key -> size table; single-writer once built.
+struct ObjSet {
+    struct Slot { uint64_t key; int64_t size; };
+    Vec<Slot> slots;   // key 0 = empty
+    size_t    count;
+
+    ObjSet() : count(0) {}
+
+    int64_t find(uint64_t key) const {
+        if (!key || !slots.n) return -1;
+        for (size_t m = slots.n - 1, i = key & m; ; i = (i + 1) & m) {
+            if (slots.p[i].key == key) return slots.p[i].size;
+            if (!slots.p[i].key) return -1;
+        }
+    }
+    void insert(uint64_t key, int64_t size) {
+        if (!key) return;
+        if (2 * (count + 1) > slots.n) grow();
+        size_t m = slots.n - 1, i = key & m;
+        while (slots.p[i].key && slots.p[i].key != key) i = (i + 1) & m;
+        if (!slots.p[i].key) ++count;
+        slots.p[i] = Slot{ key, size };
+    }
+    void grow() {
+        Vec<Slot> old = std::move(slots);
+        size_t cap = old.n ? old.n * 2 : 1024;
+        slots.reserve(cap);
+        for (size_t i = 0; i < cap; ++i) slots.push_back(Slot{ 0, 0 });
+        count = 0;
+        for (size_t i = 0; i < old.n; ++i) if (old.p[i].key) insert(old.p[i].key, old.p[i].size);
+    }
+};
+
+struct ObjScan {
+    const WStr*   obj_dir;
+    Vec<ObjSet::Slot> hits[256];
+    volatile LONG next;
+};
+
+static DWORD WINAPI obj_scan_worker(LPVOID arg) {
+    static const char hex[] = "0123456789abcdef";
+    ObjScan* sc = (ObjScan*)arg;
+    PathBuf pb(*sc->obj_dir);
+    size_t base = pb.sep().mark();
+    for (LONG i; (i = InterlockedIncrement(&sc->next) - 1) < 256; ) {
+        char pat[5] = { hex[i >> 4], hex[i & 15], '\\', '*', 0 };
+        pb.reset(base);
+        pb.append(pat, 4);
+        WIN32_FIND_DATAW fd;
+        HANDLE h = FindFirstFileExW(pb.c_str(), FindExInfoBasic, &fd, FindExSearchNameMatch,
+                                    nullptr, FIND_FIRST_EX_LARGE_FETCH);
+        if (h == INVALID_HANDLE_VALUE) continue;
+        do {
+            if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+            uint64_t k = obj_key(fd.cFileName, wcslen(fd.cFileName));
+            if (!k) continue;
+            int64_t size = ((int64_t)fd.nFileSizeHigh << 32) | fd.nFileSizeLow;
+            sc->hits[i].push_back(ObjSet::Slot{ k, size });
+        } while (FindNextFileW(h, &fd));
+        FindClose(h);
+    }
+    return 0;
+}
+
+// Lists every object already under obj_dir into set.
+static void obj_scan(const WStr& obj_dir, ObjSet& set) {
+    if (!path_is_dir(obj_dir)) return;
+    double t0 = now_ms();
+    ObjScan* sc = new ObjScan{};
+    sc->obj_dir = &obj_dir;
+    // Listing waits on the disk more than the CPU.
+    SYSTEM_INFO si{};
+    GetSystemInfo(&si);
+    size_t nthreads = si.dwNumberOfProcessors ? 2 * (size_t)si.dwNumberOfProcessors : 2;
+    if (nthreads > 32) nthreads = 32;
+    Vec<HANDLE> pool{};
+    pool.reserve(nthreads);
+    for (size_t t = 0; t < nthreads; ++t)
+        pool.push_back(CreateThread(nullptr, 0, obj_scan_worker, sc, 0, nullptr));
+    WaitForMultipleObjects((DWORD)pool.n, pool.p, TRUE, INFINITE);
+    for (size_t t = 0; t < pool.n; ++t) CloseHandle(pool.p[t]);
+    for (size_t d = 0; d < 256; ++d)
+        for (size_t i = 0; i < sc->hits[d].n; ++i) set.insert(sc->hits[d].p[i].key, sc->hits[d].p[i].size);
+    delete sc;
+    printf("  Found %zu cached asset objects in %.0f ms\n", set.count, now_ms() - t0);
+}
+
+// With have set, presence is looked up there rather than on disk, and every
+// queued object is added to it as OBJ_QUEUED, so an object listed under
+// several names is fetched once and its repeats are counted in dups.
+static const int64_t OBJ_QUEUED = -2;
+
+struct AssetSink {
+    const WStr* obj_dir;
+    DLRun*      run;
+    Vec<DLTask>* plan;
+    ObjSet*     have;
+    Str         hash;
+    int64_t     size;
+    size_t      seen, already, dups;
+    int64_t     bytes;
+};
+
+// objects > <name> > { "hash", "size" }
+static void asset_index_event(void* ctx, JSax& sx, JSaxEv ev, const char* s, size_t n) {
+    AssetSink& a = *(AssetSink*)ctx;
+    if (!sx.key_is(0, "objects")) return;
+    if (sx.depth == 2 && ev == JS_OBJ_BEGIN) {
+        a.hash.clear(); a.size = 0;
+    } else if (sx.depth == 3 && ev == JS_STR && sx.key_is(2, "hash")) {
+        a.hash.assign(s, n);
+    } else if (sx.depth == 3 && ev == JS_NUM && sx.key_is(2, "size")) {
+        a.size = sax_i64(s);
+    } else if (sx.depth == 2 && ev == JS_OBJ_END) {
+        ++a.seen;
+        if (a.hash.n < 2) return;
+        char pfx[3] = { a.hash[0], a.hash[1], 0 };
+        PathBuf dest(*a.obj_dir);
+        dest.add(pfx).add(a.hash.c_str());
+        uint64_t key = obj_key(a.hash.data(), a.hash.n);
+        LONGLONG have = a.plan ? -1 : a.have ? a.have->find(key) : path_file_size_w(dest.c_str());
+        if (have == OBJ_QUEUED) { ++a.dups; return; }
+        if (have > 0 && (a.size <= 0 || have == a.size)) { ++a.already; return; }
+        DLTask t{};
+        t.url.assign_s(RESOURCES_URL);
+        t.url.append_s(pfx);
+        t.url.append_c('/');
+        t.url.append(a.hash.data(), a.hash.n);
+        t.dest = dest.wstr();
+        t.sha1.copy_from(a.hash);
+        t.size = a.size;
+        t.prio = DLP_BACKGROUND;
+        if (a.plan) a.plan->push_back(std::move(t));
+        else        a.run->q.push(std::move(t));
+        if (a.have) a.have->insert(key, OBJ_QUEUED);
+        a.bytes += a.size;
+    }
+}
+
+// Streams a JSON document into feed from its copy on disk, or from url while
+// writing that copy. A failed fetch leaves no file behind.
+// expect, when given, is the document's {sha1, size} entry: a copy on disk
+// that does not match it is fetched again. A fetch is kept through
+// <file>.part, so an interrupted one never leaves a truncated copy behind.
+static bool sax_stream_cached(const WStr& file, const char* url, SaxFeed& feed,
+                              const JVal& expect = JVal::null_ref()) {
+    Str sha1{}; sha1.assign_s(expect["sha1"].str());
+    int64_t size = expect["size"].i64();
+    bool have = path_exists(file);
+    if (have && file_matches(file, sha1, size)) return read_file_stream(file, sax_feed_chunk, &feed);
+    if (!url || !*url) return false;
+    if (have) fputs("  Cached copy is damaged; fetching it again.\n", stderr);
+    Str u{}; u.assign_s(url);
+    WStr part = part_path(file);
+    feed.cache = CreateFileW(part.c_str(), GENERIC_WRITE, 0, nullptr,
+                             CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    bool cached = feed.cache != INVALID_HANDLE_VALUE;
+    bool ok = http_get_stream(u, sax_feed_chunk, &feed);
+    if (cached) CloseHandle(feed.cache);
+    feed.cache = INVALID_HANDLE_VALUE;
+    if (cached) {
+        if (ok && !file_matches(part, sha1, size)) {
+            fputs("  Downloaded copy does not match its hash.\n", stderr);
+            ok = false;
+        }
+        if (!ok || !MoveFileExW(part.c_str(), file.c_str(), MOVEFILE_REPLACE_EXISTING))
+            DeleteFileW(part.c_str());
+    }
+    return ok;
+}
+
+// The file manifest of a runtime component is kept as runtime/<component>.json
+// so the install can be verified later without going back to the network.
+static WStr runtime_manifest_file(const WStr& root, const char* component) {
+    Str name{}; name.assign_s(component); name.append_s(".json");
+    return pjoin(pjoin(root, "runtime"), name.c_str());
+}
+
+static Str runtime_manifest_url(const char* component) {
+    Str r{};
+    fputs("  Fetching Mojang runtime index...\n", stdout);
+    Str url{}; url.assign_s(RUNTIME_ALL_URL);
+    Str all_str = http_get_str(url);
+    if (all_str.empty()) { fputs("  Failed to fetch runtime index.\n", stderr); return r; }
+    JDoc all_doc = parse_json(std::move(all_str));
+    const JVal& all_j = all_doc.root;
+
+    const char* platform = "windows-x64";
+    if (!all_j.has(platform) || !all_j[platform].has(component)) {
+        fprintf(stderr, "  Component '%s' not found for %s.\n", component, platform);
+        return r;
+    }
+    const JVal& comp_arr = all_j[platform][component];
+    if (!comp_arr.is_array() || !comp_arr.size()) {
+        fputs("  Empty component entry.\n", stderr); return r;
+    }
+    const char* manifest_url = comp_arr[(size_t)0]["manifest"]["url"].str();
+    if (!manifest_url || !*manifest_url) { fputs("  No manifest URL.\n", stderr); return r; }
+    r.assign_s(manifest_url);
+    return r;
+}
+
 static bool install_bundled_jre(const WStr& root, Config& cfg, const WStr& cfg_path,
                                  const char* mc_ver = "") {
     const char* component = (!mc_ver || !*mc_ver) ? "jre-legacy"
@@ -1074,58 +4324,31 @@ static bool install_bundled_jre(const WStr& root, Config& cfg, const WStr& cfg_p
     printf("\nNo bundled JRE found for '%s'.\n", component);
     printf("Download Mojang JRE (%s) automatically? (y/n): ", component);
     Str ans = read_line();
-    if (ans.empty() || (ans.p[0] != 'y' && ans.p[0] != 'Y')) return false;
-
-    fputs("  Fetching Mojang runtime index...\n", stdout);
-    Str url{}; url.assign_s(RUNTIME_ALL_URL);
-    Str all_str = http_get_str(url);
-    if (all_str.empty()) { fputs("  Failed to fetch runtime index.\n", stderr); return false; }
-    JVal all_j = parse_json(all_str);
+    if (ans.empty() || (ans.data()[0] != 'y' && ans.data()[0] != 'Y')) return false;
 
-    const char* platform = "windows-x64";
-    if (!all_j.has(platform) || !all_j[platform].has(component)) {
-        fprintf(stderr, "  Component '%s' not found for %s.\n", component, platform);
-        return false;
-    }
-    const JVal& comp_arr = all_j[platform][component];
-    if (!comp_arr.is_array() || !comp_arr.arr_n) {
-        fputs("  Empty component entry.\n", stderr); return false;
+    WStr man_file = runtime_manifest_file(root, component);
+    Str manifest_url{};
+    if (!path_exists(man_file)) {
+        manifest_url = runtime_manifest_url(component);
+        if (manifest_url.empty()) return false;
     }
-    const char* manifest_url = comp_arr.arr[0]["manifest"]["url"].str();
-    if (!manifest_url || !*manifest_url) { fputs("  No manifest URL.\n", stderr); return false; }
 
     printf("  Fetching file manifest for '%s'...\n", component);
-    Str mu{}; mu.assign_s(manifest_url);
-    Str mf_str = http_get_str(mu);
-    if (mf_str.empty()) { fputs("  Failed to fetch file manifest.\n", stderr); return false; }
-    JVal mf = parse_json(mf_str);
-
     create_dirs(jre_dir);
-    const JVal& files = mf["files"];
-
-    Vec<DLTask> tasks{};
-    tasks.reserve(files.obj_n);
-    for (size_t i = 0; i < files.obj_n; ++i) {
-        const JVal& entry = files.obj_vals[i];
-        WStr rel = pjoin(jre_dir, files.obj_keys[i].c_str());
-
-        if (!strcmp(entry["type"].str(), "directory")) {
-            create_dirs(rel);
-            continue;
-        }
-        if (strcmp(entry["type"].str(), "file") != 0) continue;
-        if (!entry.has("downloads") || !entry["downloads"].has("raw")) continue;
-        const char* dl_url = entry["downloads"]["raw"]["url"].str();
-        if (!dl_url || !*dl_url) continue;
 
-        DLTask t{};
-        t.url.assign_s(dl_url);
-        t.dest = std::move(rel);
-        tasks.push_back(std::move(t));
-    }
+    // Files start downloading as soon as their manifest entry has streamed in.
+    DLRun run{};
+    dl_run_start(run, 16);
+    JreSink sink{ &jre_dir, &run, nullptr, {}, {}, {}, 0, 0, 0 };
+    JSax sx(jre_manifest_event, &sink);
+    SaxFeed feed{ &sx, INVALID_HANDLE_VALUE };
+    bool ok = sax_stream_cached(man_file, manifest_url.c_str(), feed);
+    sx.finish();
+    if (!ok) fputs("  Failed to fetch file manifest.\n", stderr);
 
-    printf("  Downloading %zu JRE files...\n", tasks.n);
-    parallel_dl(tasks, 16);
+    printf("  Downloading %zu JRE files (%.1f MB)...\n", sink.nfiles, sink.bytes / 1048576.0);
+    dl_run_finish(run);
+    if (!ok) return false;
 
     WStr found = find_java_in_dir(jre_dir);
     if (found.empty()) {
@@ -1141,7 +4364,10 @@ static bool install_bundled_jre(const WStr& root, Config& cfg, const WStr& cfg_p
     return true;
 }
 
-static bool download_assets(const WStr& root, const JVal& vj) {
+// Streams the version's asset index into sink (from disk, or from the network
+// while caching it to disk); the sink queues or plans objects as their hashes
+// are read.
+static bool stream_asset_index(const WStr& root, const JVal& vj, AssetSink& sink) {
     const char* idx_url = vj["assetIndex"]["url"].str();
     const char* idx_id  = vj["assetIndex"]["id"].str();
     if (!idx_url || !*idx_url || !idx_id || !*idx_id) {
@@ -1153,51 +4379,124 @@ static bool download_assets(const WStr& root, const JVal& vj) {
     create_dirs(idx_dir);
     Str idx_id_str{}; idx_id_str.assign_s(idx_id);
     idx_id_str.append_s(".json");
-    WStr idx_file = pjoin(idx_dir, idx_id_str.c_str());
 
-    Str idx_str{};
-    if (path_exists(idx_file)) {
-        idx_str = read_file(idx_file);
-    } else {
-        Str u{}; u.assign_s(idx_url);
-        idx_str = http_get_str(u);
-        if (idx_str.empty()) { fputs("  Failed to fetch asset index.\n", stderr); return false; }
-        write_file(idx_file, idx_str.c_str(), idx_str.n);
-    }
+    JSax sx(asset_index_event, &sink);
+    SaxFeed feed{ &sx, INVALID_HANDLE_VALUE };
+    bool ok = sax_stream_cached(pjoin(idx_dir, idx_id_str.c_str()), idx_url, feed, vj["assetIndex"]);
+    sx.finish();
+    return ok;
+}
 
-    JVal idx_json = parse_json(idx_str);
-    const JVal& objs = idx_json["objects"];
+// Parses a JSON document from its copy on disk, or fetches it from url and
+// keeps that copy. The root is not an object on failure.
+static JDoc fetch_json_cached(const WStr& file, const char* url) {
+    if (path_exists(file)) return parse_json_file(file);
+    Str u{}; u.assign_s(url);
+    Str r = http_get_str(u);
+    if (!r.empty()) write_file(file, r.c_str(), r.n);
+    return parse_json(std::move(r));
+}
 
-    WStr obj_dir = pjoin(pjoin(root, "assets"), "objects");
+static int cmp_task_dest(const void* a, const void* b) {
+    return wcscmp((*(const DLTask* const*)a)->dest.c_str(), (*(const DLTask* const*)b)->dest.c_str());
+}
+
+// Drops tasks whose destination repeats an earlier one, keeping a
+// continuation either had; a profile shares libraries with its base version.
+static void dl_dedupe(Vec<DLTask>& tasks) {
+    if (tasks.n < 2) return;
+    Vec<DLTask*> by_dest{};
+    by_dest.reserve(tasks.n);
+    for (size_t i = 0; i < tasks.n; ++i) by_dest.push_back(&tasks.p[i]);
+    qsort(by_dest.p, by_dest.n, sizeof(DLTask*), cmp_task_dest);
+    size_t keep = 0;
+    for (size_t i = 1; i < by_dest.n; ++i) {
+        DLTask* k = by_dest.p[keep];
+        DLTask* d = by_dest.p[i];
+        if (wcscmp(k->dest.c_str(), d->dest.c_str())) { keep = i; continue; }
+        if (!k->then) { k->then = d->then; k->then_ctx = d->then_ctx; }
+        d->url.clear();
+    }
+    Vec<DLTask> out{};
+    out.reserve(tasks.n);
+    for (size_t i = 0; i < tasks.n; ++i)
+        if (!tasks.p[i].url.empty()) out.push_back(std::move(tasks.p[i]));
+    tasks = std::move(out);
+}
+
+// Downloads everything a version needs as one run: the client jar and the
+// libraries are queued first, then the asset index is streamed on this thread
+// with objects queued as they are read, so the stages overlap instead of
+// following one another. Native JARs are unpacked by their continuations as
+// each one lands. profile, when given, is a loader profile layered on vj whose
+// libraries join the same run.
+static bool install_version_files(const WStr& root, const char* version, const JVal& vj,
+                                  const WStr& ver_jar, const JVal* profile) {
+    double t0 = now_ms();
+    NativesJob nat{};
+    nat.nat_dir = natives_dir(root, version);
+    create_dirs(nat.nat_dir);
+    natives_load(nat);
 
     Vec<DLTask> tasks{};
-    size_t already = 0;
-    for (size_t i = 0; i < objs.obj_n; ++i) {
-        const char* hash = objs.obj_vals[i]["hash"].str();
-        if (!hash || strlen(hash) < 2) continue;
-        char pfx[3] = { hash[0], hash[1], 0 };
-        WStr dest = pjoin(pjoin(obj_dir, pfx), hash);
-        if (path_exists(dest) && path_file_size(dest) > 0) { ++already; continue; }
-        DLTask t{};
-        t.url.assign_s(RESOURCES_URL);
-        t.url.append_s(pfx);
-        t.url.append_c('/');
-        t.url.append_s(hash);
-        t.dest = std::move(dest);
-        tasks.push_back(std::move(t));
+    download_libraries_to_tasks(root, vj, tasks, natives_on_jar, &nat);
+    if (profile) download_libraries_to_tasks(root, *profile, tasks, natives_on_jar, &nat);
+    dl_dedupe(tasks);
+    size_t nlibs = tasks.n;
+
+    const JVal& client = vj["downloads"]["client"];
+    DLTask jar{};
+    jar.url.assign_s(client["url"].str());
+    jar.dest.copy_from(ver_jar);
+    dl_expect(jar, client);
+    DLTask jar_check{};
+    jar_check.dest.copy_from(ver_jar);
+    jar_check.size = jar.size;
+    tasks.push_back(std::move(jar));
+
+    dl_background_wait();
+    DLRun* run = new DLRun{};
+    dl_run_start(*run, 24);
+    for (size_t i = 0; i < tasks.n; ++i) run->q.push(std::move(tasks.p[i]));
+    printf("  Queued client JAR and %zu libraries; streaming asset index...\n", nlibs);
+
+    WStr obj_dir = pjoin(pjoin(root, "assets"), "objects");
+    ObjSet have{};
+    obj_scan(obj_dir, have);
+    AssetSink sink{ &obj_dir, run, nullptr, &have, {}, 0, 0, 0, 0, 0 };
+    if (!stream_asset_index(root, vj, sink)) fputs("  Failed to fetch asset index.\n", stderr);
+    printf("  Fetching %zu assets, %.1f MB to download (%zu already cached, %zu shared)...\n",
+           sink.seen, sink.bytes / 1048576.0, sink.already, sink.dups);
+    if (g_early_launch) {
+        // Natives are continuations of critical tasks, so they are done too.
+        dl_run_wait_critical(*run);
+        LONG left = run->q.total - run->ndone;
+        if (left > 0) {
+            printf("  Launch-ready in %.1f s; %ld assets continue in the background.\n",
+                   (now_ms() - t0) / 1000.0, left);
+            dl_run_detach(run);
+            run = nullptr;
+        }
     }
+    if (run) {
+        dl_run_finish(*run);
+        delete run;
+        printf("  Install took %.1f s\n", (now_ms() - t0) / 1000.0);
+    }
+
+    natives_finish(nat);
+    natives_report(nat);
 
-    printf("  Fetching %zu assets (%zu already cached)...\n",
-           objs.obj_n, already);
-    parallel_dl(tasks, 24);
+    if (!dl_have(jar_check)) { fputs("Failed to download client JAR.\n", stderr); return false; }
     return true;
 }
 
 static bool download_minecraft_base(const WStr& root, const char* version,
-                                     const JVal& manifest, bool print_steps = true) {
+                                     const JVal& manifest, bool print_steps = true,
+                                     const JVal* profile = nullptr) {
     const char* ver_url = nullptr;
-    for (size_t i = 0; i < manifest["versions"].arr_n; ++i) {
-        const JVal& v = manifest["versions"].arr[i];
+    for (size_t i = 0; i < manifest["versions"].size(); ++i) {
+        const JVal& v = manifest["versions"][i];
         if (!strcmp(v["id"].str(), version)) { ver_url = v["url"].str(); break; }
     }
     if (!ver_url || !*ver_url) {
@@ -1212,36 +4511,12 @@ static bool download_minecraft_base(const WStr& root, const char* version,
     WStr ver_jar  = pjoin(ver_dir, verjar_name.c_str());
     create_dirs(ver_dir);
 
-    if (print_steps) printf("[2/5] Fetching %s version JSON...\n", version);
-    Str ver_str{};
-    if (path_exists(ver_json)) {
-        ver_str = read_file(ver_json);
-    } else {
-        Str u{}; u.assign_s(ver_url);
-        ver_str = http_get_str(u);
-        if (ver_str.empty()) { fputs("Failed to fetch version JSON.\n", stderr); return false; }
-        write_file(ver_json, ver_str.c_str(), ver_str.n);
-    }
-    JVal vj = parse_json(ver_str);
-
-    if (print_steps) fputs("[3/5] Downloading client JAR...\n", stdout);
-    Str jar_url{}; jar_url.assign_s(vj["downloads"]["client"]["url"].str());
-    if (!download_file(jar_url, ver_jar)) {
-        fputs("Failed to download client JAR.\n", stderr); return false;
-    }
-
-    if (print_steps) fputs("[4/5] Downloading libraries...\n", stdout);
-    Vec<DLTask> lib_tasks{};
-    download_libraries_to_tasks(root, vj, lib_tasks);
-    parallel_dl(lib_tasks, 16);
-
-    if (print_steps) fputs("[4/5] Extracting natives...\n", stdout);
-    extract_natives(root, version, vj);
+    if (print_steps) printf("[2/3] Fetching %s version JSON...\n", version);
+    JDoc vdoc = fetch_json_cached(ver_json, ver_url);
+    if (!vdoc.root.is_object()) { fputs("Failed to fetch version JSON.\n", stderr); return false; }
 
-    if (print_steps) fputs("[5/5] Downloading assets...\n", stdout);
-    download_assets(root, vj);
-
-    return true;
+    if (print_steps) fputs("[3/3] Downloading client JAR, libraries, natives and assets...\n", stdout);
+    return install_version_files(root, version, vdoc.root, ver_jar, profile);
 }
 
 static bool download_fabric(const WStr& root, const char* mc_version, const JVal& manifest) {
@@ -1255,13 +4530,14 @@ static bool download_fabric(const WStr& root, const char* mc_version, const JVal
         fputs("Failed to fetch Fabric loader list.\n", stderr);
         return false;
     }
-    JVal loaders_j = parse_json(loaders_str);
-    if (!loaders_j.is_array() || !loaders_j.arr_n) {
+    JDoc loaders_doc = parse_json(std::move(loaders_str));
+    const JVal& loaders_j = loaders_doc.root;
+    if (!loaders_j.is_array() || !loaders_j.size()) {
         fputs("No Fabric loaders available for this Minecraft version.\n", stderr);
         return false;
     }
 
-    const char* loader_ver = loaders_j.arr[0]["loader"]["version"].str();
+    const char* loader_ver = loaders_j[(size_t)0]["loader"]["version"].str();
     if (!loader_ver || !*loader_ver) { fputs("Could not determine Fabric loader version.\n", stderr); return false; }
     printf("Using Fabric Loader: %s\n", loader_ver);
 
@@ -1276,7 +4552,7 @@ static bool download_fabric(const WStr& root, const char* mc_version, const JVal
     WStr ver_json = pjoin(ver_dir, vjname.c_str());
     create_dirs(ver_dir);
 
-    fputs("[1/5] Fetching Fabric profile JSON...\n", stdout);
+    fputs("[1/3] Fetching Fabric profile JSON...\n", stdout);
     Str profile_url{};
     profile_url.assign_s(FABRIC_META_BASE);
     profile_url.append_s("loader/");
@@ -1285,34 +4561,241 @@ static bool download_fabric(const WStr& root, const char* mc_version, const JVal
     profile_url.append_s(loader_ver);
     profile_url.append_s("/profile/json");
 
-    Str profile_str{};
-    if (path_exists(ver_json)) {
-        profile_str = read_file(ver_json);
-    } else {
-        profile_str = http_get_str(profile_url);
-        if (profile_str.empty()) { fputs("Failed to fetch Fabric profile JSON.\n", stderr); return false; }
-        write_file(ver_json, profile_str.c_str(), profile_str.n);
-    }
-    JVal fabric_vj = parse_json(profile_str);
+    JDoc fabric_doc = fetch_json_cached(ver_json, profile_url.c_str());
+    if (!fabric_doc.root.is_object()) { fputs("Failed to fetch Fabric profile JSON.\n", stderr); return false; }
 
-    printf("[2/5] Downloading base Minecraft %s...\n", mc_version);
-    if (!download_minecraft_base(root, mc_version, manifest, false)) {
+    // Fabric's libraries and natives go into the same run as the base game's.
+    printf("[2/3] Downloading Minecraft %s with Fabric libraries...\n", mc_version);
+    if (!download_minecraft_base(root, mc_version, manifest, false, &fabric_doc.root)) {
         fputs("Failed to download base Minecraft for Fabric.\n", stderr);
         return false;
     }
 
-    fputs("[3/5] Downloading Fabric libraries...\n", stdout);
-    Vec<DLTask> fabric_lib_tasks{};
-    download_libraries_to_tasks(root, fabric_vj, fabric_lib_tasks);
-    parallel_dl(fabric_lib_tasks, 16);
+    printf("\nFabric install complete: %s\n", fabric_id.c_str());
+    return true;
+}
 
-    fputs("[3/5] Extracting Fabric natives (if any)...\n", stdout);
-    extract_natives(root, mc_version, fabric_vj);
+// ---- Install verification ----------------------------------------------------
+//
+// The plan of an installed version (client jar, libraries including natives
+// jars, asset objects and bundled JRE files) is rebuilt from its JSONs and the
+// cached asset index / runtime manifest. Every file is then checked on all
+// cores, hashing from mapped views, and only what is missing or does not
+// match is downloaded again.
 
-    fputs("[4/5] (assets already fetched with base MC)\n", stdout);
+enum VState : uint8_t { VS_OK, VS_MISSING, VS_CORRUPT };
 
-    printf("\nFabric install complete: %s\n", fabric_id.c_str());
-    return true;
+// Files are hashed through views of at most this size (a multiple of the
+// 64 KB allocation granularity), so any file size fits a 32-bit address space.
+inline constexpr size_t VERIFY_VIEW = (size_t)64 << 20;
+
+static VState verify_file(const DLTask& t) {
+    HANDLE h = CreateFileW(t.dest.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return VS_MISSING;
+    LARGE_INTEGER li{};
+    GetFileSizeEx(h, &li);
+    LONGLONG size = li.QuadPart;
+    if (size < 0 || (t.size > 0 && size != t.size)) { CloseHandle(h); return VS_CORRUPT; }
+    if (t.sha1.empty()) { CloseHandle(h); return VS_OK; }
+
+    // An empty file cannot be mapped; it is checked against the hash of no
+    // data, so manifest entries for empty files pass.
+    Sha1 sh;
+    HANDLE map = size ? CreateFileMappingW(h, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    bool ok = map != nullptr || !size;
+    for (LONGLONG off = 0; ok && off < size; off += (LONGLONG)VERIFY_VIEW) {
+        size_t len = size - off < (LONGLONG)VERIFY_VIEW ? (size_t)(size - off) : VERIFY_VIEW;
+        const void* v = MapViewOfFile(map, FILE_MAP_READ, (DWORD)(off >> 32), (DWORD)off, len);
+        if (!v) { ok = false; break; }
+        sh.update(v, len);
+        UnmapViewOfFile(v);
+    }
+    if (map) CloseHandle(map);
+    CloseHandle(h);
+    if (!ok) return VS_CORRUPT;
+    uint8_t d[20];
+    sh.final(d);
+    return sha1_matches(d, t.sha1) ? VS_OK : VS_CORRUPT;
+}
+
+struct VerifyJob {
+    const Vec<DLTask>* plan;
+    Vec<uint8_t>       state;     // VState per plan entry
+    volatile LONG      next, ndone;
+};
+
+static DWORD WINAPI verify_worker(LPVOID arg) {
+    VerifyJob* j = (VerifyJob*)arg;
+    LONG n = (LONG)j->plan->n, i;
+    while ((i = InterlockedIncrement(&j->next) - 1) < n) {
+        j->state.p[i] = (uint8_t)verify_file(j->plan->p[i]);
+        InterlockedIncrement(&j->ndone);
+    }
+    return 0;
+}
+
+// Checks every entry of plan with one worker per logical processor.
+static void verify_run(VerifyJob& job) {
+    const Vec<DLTask>& plan = *job.plan;
+    job.state.reserve(plan.n);
+    for (size_t i = 0; i < plan.n; ++i) job.state.push_back(VS_OK);
+    if (plan.empty()) return;
+
+    SYSTEM_INFO si{};
+    GetSystemInfo(&si);
+    size_t nthreads = si.dwNumberOfProcessors ? si.dwNumberOfProcessors : 1;
+    if (nthreads > MAXIMUM_WAIT_OBJECTS) nthreads = MAXIMUM_WAIT_OBJECTS;
+    if (nthreads > plan.n) nthreads = plan.n;
+
+    Vec<HANDLE> pool{};
+    pool.reserve(nthreads);
+    for (size_t t = 0; t < nthreads; ++t)
+        pool.push_back(CreateThread(nullptr, 0, verify_worker, &job, 0, nullptr));
+    LONG total = (LONG)plan.n;
+    while (WaitForMultipleObjects((DWORD)pool.n, pool.p, TRUE, 100) == WAIT_TIMEOUT) {
+        printf("  %ld/%ld\r", job.ndone, total);
+        fflush(stdout);
+    }
+    for (size_t t = 0; t < pool.n; ++t) CloseHandle(pool.p[t]);
+    printf("  %ld/%ld\n", total, total);
+}
+
+// Verifies an installed version and re-downloads whatever is missing or
+// corrupt, asking first when ask is set. Without assets only what the game
+// needs to start is checked (client jar, libraries, natives, JRE), so it
+// does not wait for a background run. Returns true if the checked part of
+// the install is complete afterwards.
+static bool verify_install(const WStr& root, const char* version, bool ask, bool assets = true) {
+    Str vjname{}; vjname.assign_s(version); vjname.append_s(".json");
+    WStr vj_path = pjoin(pjoin(pjoin(root, "versions"), version), vjname.c_str());
+    if (!path_exists(vj_path)) {
+        fprintf(stderr, "Not installed: %s\n", version);
+        return false;
+    }
+    if (assets) dl_background_wait();
+    JDoc vdoc = load_json_cached(vj_path);
+    const JVal& vj = vdoc.root;
+
+    Vec<DLTask> plan{};
+    download_libraries_to_tasks(root, vj, plan);
+
+    // A Fabric profile only adds libraries; everything else comes from the
+    // version it inherits from.
+    Str base_ver{}; base_ver.assign_s(version);
+    JDoc base_doc{};
+    const JVal* base_vj = &vj;
+    if (vj.has("inheritsFrom")) {
+        base_ver.assign_s(vj["inheritsFrom"].str());
+        Str bname{}; bname.copy_from(base_ver); bname.append_s(".json");
+        WStr bpath = pjoin(pjoin(pjoin(root, "versions"), base_ver.c_str()), bname.c_str());
+        if (!path_exists(bpath)) {
+            fprintf(stderr, "Base version %s is not installed.\n", base_ver.c_str());
+            return false;
+        }
+        base_doc = load_json_cached(bpath);
+        base_vj  = &base_doc.root;
+        download_libraries_to_tasks(root, *base_vj, plan);
+    }
+
+    const JVal& client = (*base_vj)["downloads"]["client"];
+    if (client.has("url")) {
+        Str jname{}; jname.copy_from(base_ver); jname.append_s(".jar");
+        DLTask jar{};
+        jar.url.assign_s(client["url"].str());
+        jar.dest = pjoin(pjoin(pjoin(root, "versions"), base_ver.c_str()), jname.c_str());
+        dl_expect(jar, client);
+        plan.push_back(std::move(jar));
+    }
+    size_t nlibs = plan.n;
+
+    WStr obj_dir = pjoin(pjoin(root, "assets"), "objects");
+    AssetSink sink{ &obj_dir, nullptr, &plan, nullptr, {}, 0, 0, 0, 0, 0 };
+    if (assets && !stream_asset_index(root, *base_vj, sink))
+        fputs("  Asset index unavailable; assets not checked.\n", stderr);
+
+    // The bundled JRE is only checked when one has been installed.
+    const char* component = get_runtime_component(base_ver.c_str());
+    WStr jre_dir = pjoin(pjoin(root, "runtime"), component);
+    if (path_is_dir(jre_dir)) {
+        WStr man_file = runtime_manifest_file(root, component);
+        Str manifest_url{};
+        if (!path_exists(man_file)) manifest_url = runtime_manifest_url(component);
+        JreSink sink{ &jre_dir, nullptr, &plan, {}, {}, {}, 0, 0, 0 };
+        JSax sx(jre_manifest_event, &sink);
+        SaxFeed feed{ &sx, INVALID_HANDLE_VALUE };
+        bool ok = sax_stream_cached(man_file, manifest_url.c_str(), feed);
+        sx.finish();
+        if (!ok) fputs("  Runtime manifest unavailable; JRE not checked.\n", stderr);
+    }
+
+    printf("  Verifying %zu files...\n", plan.n);
+    ULONGLONG t0 = GetTickCount64();
+    VerifyJob job{ &plan, {}, 0, 0 };
+    verify_run(job);
+
+    Vec<DLTask*> bad{};
+    size_t nmissing = 0, ncorrupt = 0;
+    bool libs_bad = false;
+    int64_t bytes = 0;
+    for (size_t i = 0; i < plan.n; ++i) {
+        if (plan.p[i].size > 0) bytes += plan.p[i].size;
+        if (job.state.p[i] == VS_OK) continue;
+        if (job.state.p[i] == VS_MISSING) ++nmissing; else ++ncorrupt;
+        if (i < nlibs) libs_bad = true;
+        bad.push_back(&plan.p[i]);
+    }
+    printf("  Checked %.1f MB in %llu ms: %zu missing, %zu corrupt.\n",
+           bytes / 1048576.0, (unsigned long long)(GetTickCount64() - t0), nmissing, ncorrupt);
+    // The natives manifest makes this a check of the extracted files when
+    // none of the JARs changed.
+    if (!assets && !libs_bad)
+        extract_natives(root, base_ver.c_str(), *base_vj, base_vj != &vj ? &vj : nullptr);
+    if (bad.empty()) return true;
+
+    // Identical asset objects appear under several names; repair each once.
+    qsort(bad.p, bad.n, sizeof(DLTask*), cmp_task_dest);
+    Vec<DLTask> repair{};
+    for (size_t i = 0; i < bad.n; ++i) {
+        if (repair.n && !wcscmp(bad.p[i]->dest.c_str(), repair.p[repair.n - 1].dest.c_str())) continue;
+        if (repair.n < 10) {
+            Str ps = path_to_str(bad.p[i]->dest);
+            printf("    %s\n", ps.c_str());
+        }
+        repair.push_back(std::move(*bad.p[i]));
+    }
+    if (repair.n > 10) printf("    ... and %zu more\n", repair.n - 10);
+
+    if (ask) {
+        printf("\nRe-download %zu files? (y/n): ", repair.n);
+        Str ans = read_line();
+        if (ans.empty() || (ans.data()[0] != 'y' && ans.data()[0] != 'Y')) return false;
+    }
+    // A corrupt file of the right size would otherwise be taken as present,
+    // and a hard-linked one may have damaged its store object too.
+    // parallel_dl consumes the tasks, so keep what is needed to recheck them.
+    Vec<DLTask> check{};
+    check.reserve(repair.n);
+    for (size_t i = 0; i < repair.n; ++i) {
+        DeleteFileW(repair.p[i].dest.c_str());
+        store_evict(repair.p[i]);
+        DLTask c{};
+        c.dest.copy_from(repair.p[i].dest);
+        c.size = repair.p[i].size;
+        check.push_back(std::move(c));
+    }
+    printf("  Repairing %zu files...\n", repair.n);
+    parallel_dl(repair, 16);
+
+    if (libs_bad) {
+        extract_natives(root, base_ver.c_str(), *base_vj, base_vj != &vj ? &vj : nullptr);
+    }
+
+    size_t still = 0;
+    for (size_t i = 0; i < check.n; ++i)
+        if (!dl_have(check.p[i])) ++still;
+    if (still) fprintf(stderr, "  %zu files could not be repaired.\n", still);
+    return still == 0;
 }
 
 struct KVPair { Str key; Str val; };
@@ -1342,7 +4825,7 @@ static Str tok_replace(const char* s, size_t slen, const VarMap& m) {
             while (e < slen && s[e] != '}') ++e;
             if (e < slen) {
                 const Str* val = m.get(s + i + 2, e - i - 2);
-                if (val) r.append(val->p, val->n);
+                if (val) r.append(val->data(), val->n);
                 else     r.append(s + i, e - i + 1);
                 i = e + 1;
                 continue;
@@ -1360,13 +4843,13 @@ static Str tok_replace_str(const Str& s, const VarMap& m) {
 static Str win_quote(const Str& s) {
     bool needs = false;
     for (size_t i = 0; i < s.n && !needs; ++i)
-        if (s.p[i] == ' ' || s.p[i] == '\t' || s.p[i] == '"') needs = true;
+        if (s.data()[i] == ' ' || s.data()[i] == '\t' || s.data()[i] == '"') needs = true;
     if (!needs && !s.empty()) { Str r{}; r.copy_from(s); return r; }
     Str r{};
     r.append_c('"');
     int sl = 0;
     for (size_t i = 0; i < s.n; ++i) {
-        char c = s.p[i];
+        char c = s.data()[i];
         if (c == '\\') {
             ++sl;
         } else if (c == '"') {
@@ -1401,29 +4884,33 @@ struct CPEntry { Str ga_key; Str full_path; };
 
 static Str build_classpath(const WStr& root, const JVal& vj, const JVal& parent_vj,
                             const char* jar_ver) {
-    WStr lib_dir = pjoin(root, "libraries");
+    PathBuf lib_dir(root);
+    lib_dir.add("libraries");
+    size_t lib_base = lib_dir.mark();
     Vec<CPEntry> entries{};
 
     auto add_libs = [&](const JVal& j) {
-        if (!j.has("libraries")) return;
-        for (size_t i = 0; i < j["libraries"].arr_n; ++i) {
-            const JVal& lib = j["libraries"].arr[i];
+        const JVal* libs = j.find(JK_LIBRARIES);
+        if (!libs) return;
+        for (size_t i = 0; i < libs->size(); ++i) {
+            const JVal& lib = (*libs)[i];
             if (!lib_applies(lib)) continue;
             if (lib_is_native_only(lib)) continue;
             const char* path = nullptr;
-            if (lib.has("downloads") && lib["downloads"].has("artifact"))
-                path = lib["downloads"]["artifact"]["path"].str();
+            if (const JVal* a = lib[JK_DOWNLOADS].find(JK_ARTIFACT))
+                path = (*a)[JK_PATH].str();
             Str mpath{};
             if (!path || !*path) {
                 if (lib.has("name")) mpath = maven_path(lib["name"].str());
                 if (!mpath.empty()) path = mpath.c_str();
             }
             if (!path || !*path) continue;
-            WStr jar = pjoin(lib_dir, path);
-            if (!path_exists(jar)) continue;
+            lib_dir.reset(lib_base);
+            lib_dir.add(path);
+            if (!path_exists_w(lib_dir.c_str())) continue;
 
             Str ga   = maven_ga_key(path);
-            Str full = path_to_str(jar);
+            Str full = lib_dir.utf8();
 
             bool found = false;
             for (size_t k = 0; k < entries.n; ++k) {
@@ -1446,12 +4933,12 @@ static Str build_classpath(const WStr& root, const JVal& vj, const JVal& parent_
 
     Str cp{};
     for (size_t i = 0; i < entries.n; ++i) {
-        cp.append(entries.p[i].full_path.p, entries.p[i].full_path.n);
+        cp.append(entries.p[i].full_path.data(), entries.p[i].full_path.n);
         cp.append_c(';');
     }
-    Str jar_name{}; jar_name.assign_s(jar_ver); jar_name.append_s(".jar");
-    WStr main_jar = pjoin(pjoin(pjoin(root, "versions"), jar_ver), jar_name.c_str());
-    { Str main_jar_s = path_to_str(main_jar); cp.append(main_jar_s.p, main_jar_s.n); }
+    PathBuf main_jar(root);
+    main_jar.add("versions").add(jar_ver).add(jar_ver).append(".jar");
+    { Str main_jar_s = main_jar.utf8(); cp.append(main_jar_s.data(), main_jar_s.n); }
     return cp;
 }
 
@@ -1465,10 +4952,13 @@ static bool launch_version(const WStr& root, const Config& cfg, const char* vers
         return false;
     }
 
-    Str ver_str = read_file(vj_path);
-    JVal vj = parse_json(ver_str);
+#ifdef GOONMC_PROFILE
+    double t_launch = now_ms();
+#endif
+    JDoc vdoc = load_json_cached(vj_path);
+    const JVal& vj = vdoc.root;
 
-    JVal parent_vj{};
+    JDoc parent_doc{};
     Str base_ver{}; base_ver.assign_s(version);
 
     if (vj.has("inheritsFrom")) {
@@ -1479,10 +4969,10 @@ static bool launch_version(const WStr& root, const Config& cfg, const char* vers
             fprintf(stderr, "Base version '%s' not installed.\n", base_ver.c_str());
             return false;
         }
-        Str ps = read_file(pj_path);
-        parent_vj = parse_json(ps);
+        parent_doc = load_json_cached(pj_path);
     }
 
+    const JVal& parent_vj = parent_doc.root;
     bool has_parent    = !parent_vj.is_null();
     const JVal& base_vj = has_parent ? parent_vj : vj;
 
@@ -1553,8 +5043,8 @@ static bool launch_version(const WStr& root, const Config& cfg, const char* vers
     auto collect_args = [&](const JVal& src, const char* which) {
         if (!src.has("arguments") || !src["arguments"].has(which)) return;
         const JVal& arr = src["arguments"][which];
-        for (size_t i = 0; i < arr.arr_n; ++i) {
-            const JVal& e = arr.arr[i];
+        for (size_t i = 0; i < arr.size(); ++i) {
+            const JVal& e = arr[i];
             if (e.is_string()) {
                 Str a = tok_replace(e.str(), strlen(e.str()), vars);
                 args.push_back(std::move(a));
@@ -1562,10 +5052,10 @@ static bool launch_version(const WStr& root, const Config& cfg, const char* vers
             }
             if (!e.is_object()) continue;
             bool ok = true;
-            if (e.has("rules")) {
+            if (const JVal* rules = e.find(JK_RULES)) {
                 ok = false;
-                for (size_t ri = 0; ri < e["rules"].arr_n; ++ri) {
-                    const JVal& rule = e["rules"].arr[ri];
+                for (size_t ri = 0; ri < rules->size(); ++ri) {
+                    const JVal& rule = (*rules)[ri];
                     bool match = !rule.has("os") || !strcmp(rule["os"]["name"].str(), "windows");
                     if (rule.has("features")) match = false;
                     if (match) ok = !strcmp(rule["action"].str(), "allow");
@@ -1577,8 +5067,8 @@ static bool launch_version(const WStr& root, const Config& cfg, const char* vers
                 Str a = tok_replace(val.str(), strlen(val.str()), vars);
                 args.push_back(std::move(a));
             } else if (val.is_array()) {
-                for (size_t vi = 0; vi < val.arr_n; ++vi) {
-                    Str a = tok_replace(val.arr[vi].str(), strlen(val.arr[vi].str()), vars);
+                for (size_t vi = 0; vi < val.size(); ++vi) {
+                    Str a = tok_replace(val[vi].str(), strlen(val[vi].str()), vars);
                     args.push_back(std::move(a));
                 }
             }
@@ -1595,8 +5085,8 @@ static bool launch_version(const WStr& root, const Config& cfg, const char* vers
         collect_args(base_vj, "game");
     } else {
         Str a{};
-        a.assign_s("-Djava.library.path="); a.append(nat_path.p, nat_path.n); args.push_back(std::move(a));
-        a.assign_s("-Dorg.lwjgl.librarypath="); a.append(nat_path.p, nat_path.n); args.push_back(std::move(a));
+        a.assign_s("-Djava.library.path="); a.append(nat_path.data(), nat_path.n); args.push_back(std::move(a));
+        a.assign_s("-Dorg.lwjgl.librarypath="); a.append(nat_path.data(), nat_path.n); args.push_back(std::move(a));
         a.assign_s("-Dfile.encoding=UTF-8"); args.push_back(std::move(a));
         a.assign_s("-cp"); args.push_back(std::move(a));
         args.push_back(std::move(cp));
@@ -1620,10 +5110,10 @@ static bool launch_version(const WStr& root, const Config& cfg, const char* vers
         if (pos != NPOS) {
             java_exec.replace_range(pos, 8, "javaw.exe");
         } else if (java_exec.n >= 4 &&
-                   !memcmp(java_exec.p + java_exec.n - 4, "java", 4) &&
+                   !memcmp(java_exec.data() + java_exec.n - 4, "java", 4) &&
                    (java_exec.n == 4 ||
-                    java_exec.p[java_exec.n-5] == '\\' ||
-                    java_exec.p[java_exec.n-5] == '/')) {
+                    java_exec.data()[java_exec.n-5] == '\\' ||
+                    java_exec.data()[java_exec.n-5] == '/')) {
             java_exec.append_c('w');
         }
     } else {
@@ -1635,13 +5125,16 @@ static bool launch_version(const WStr& root, const Config& cfg, const char* vers
 
     Str cmd{};
     Str qexe = win_quote(java_exec);
-    cmd.append(qexe.p, qexe.n);
+    cmd.append(qexe.data(), qexe.n);
     for (size_t i = 0; i < args.n; ++i) {
         cmd.append_c(' ');
         Str qa = win_quote(args.p[i]);
-        cmd.append(qa.p, qa.n);
+        cmd.append(qa.data(), qa.n);
     }
 
+#ifdef GOONMC_PROFILE
+    fprintf(stderr, "[prof] launch_version: %.3f ms to command line\n", now_ms() - t_launch);
+#endif
     printf("\nLaunching Minecraft %s as %s...\n[CMD] %s\n\n",
            version, cfg.username.c_str(), cmd.c_str());
 
@@ -1659,7 +5152,7 @@ static bool launch_version(const WStr& root, const Config& cfg, const char* vers
         si.wShowWindow = SW_HIDE;
     }
 
-    if (!CreateProcessW(nullptr, wcmd.p, nullptr, nullptr, FALSE,
+    if (!CreateProcessW(nullptr, wcmd.data(), nullptr, nullptr, FALSE,
                         flags, nullptr, wgame_dir.c_str(), &si, &pi)) {
         fprintf(stderr, "CreateProcess failed: %lu\n", GetLastError());
         return false;
@@ -1674,36 +5167,38 @@ static Vec<Str> get_installed_versions(const WStr& root) {
     WStr ver_dir = pjoin(root, "versions");
     if (!path_exists(ver_dir)) return v;
 
-    wchar_t pattern[4096];
-    swprintf(pattern, 4096, L"%ls\\*", ver_dir.c_str());
+    PathBuf pb(ver_dir);
+    size_t ver_base = pb.mark();
+    pb.add_w(L"*");
     WIN32_FIND_DATAW fd;
-    HANDLE h = FindFirstFileW(pattern, &fd);
+    HANDLE h = FindFirstFileW(pb.c_str(), &fd);
     if (h == INVALID_HANDLE_VALUE) return v;
 
     do {
         if (!wcscmp(fd.cFileName, L".") || !wcscmp(fd.cFileName, L"..")) continue;
         if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) continue;
 
-        Str name = to_utf8_str(fd.cFileName);
-        WStr entry_dir = pjoin(ver_dir, name.c_str());
-
-        Str json_name{}; json_name.copy_from(name); json_name.append_s(".json");
-        WStr json_p = pjoin(entry_dir, json_name.c_str());
-        if (!path_exists(json_p)) continue;
+        // versions\<name>\<name>.json and .jar
+        pb.reset(ver_base);
+        pb.add_w(fd.cFileName).add_w(fd.cFileName);
+        size_t stem = pb.mark();
+        if (!path_exists_w(pb.append_w(L".json").c_str())) continue;
 
-        Str jar_name{}; jar_name.copy_from(name); jar_name.append_s(".jar");
-        WStr jar = pjoin(entry_dir, jar_name.c_str());
-        if (path_exists(jar) && path_file_size(jar) > 1024) { v.push_back(std::move(name)); continue; }
+        pb.reset(stem);
+        if (path_file_size_w(pb.append_w(L".jar").c_str()) > 1024) {
+            v.push_back(to_utf8_str(fd.cFileName));
+            continue;
+        }
 
-        Str js = read_file(json_p);
-        if (js.empty()) continue;
-        JVal jv = parse_json(js);
+        pb.reset(stem);
+        JDoc doc = load_json_cached(pb.append_w(L".json").wstr());
+        const JVal& jv = doc.root;
         if (jv.has("inheritsFrom")) {
             const char* base = jv["inheritsFrom"].str();
-            Str bjar_name{}; bjar_name.assign_s(base); bjar_name.append_s(".jar");
-            WStr base_jar = pjoin(pjoin(ver_dir, base), bjar_name.c_str());
-            if (path_exists(base_jar) && path_file_size(base_jar) > 1024)
-                v.push_back(std::move(name));
+            pb.reset(ver_base);
+            pb.add(base).add(base).append(".jar");
+            if (path_file_size_w(pb.c_str()) > 1024)
+                v.push_back(to_utf8_str(fd.cFileName));
         }
     } while (FindNextFileW(h, &fd));
     FindClose(h);
@@ -1730,7 +5225,8 @@ static void section_download(const WStr& root, Config& cfg, const WStr& cfg_path
 
     struct VE { Str id, type; };
     Vec<VE> entries{};
-    JVal manifest{};
+    JDoc manifest_doc{};
+    const JVal& manifest = manifest_doc.root;
 
     if (use_fabric) {
         fputs("Fetching Fabric supported versions...\n", stdout);
@@ -1740,22 +5236,23 @@ static void section_download(const WStr& root, Config& cfg, const WStr& cfg_path
             fputs("Failed to fetch Fabric game versions.\nPress Enter to continue...", stdout);
             getchar(); return;
         }
-        JVal fv = parse_json(fv_str);
+        JDoc fv_doc = parse_json(std::move(fv_str));
+        const JVal& fv = fv_doc.root;
         if (!fv.is_array()) {
             fputs("Unexpected Fabric version response.\nPress Enter to continue...", stdout);
             getchar(); return;
         }
-        entries.reserve(fv.arr_n);
-        for (size_t i = 0; i < fv.arr_n; ++i) {
+        entries.reserve(fv.size());
+        for (size_t i = 0; i < fv.size(); ++i) {
             VE e{};
-            e.id.assign_s(fv.arr[i]["version"].str());
-            e.type.assign_s(fv.arr[i]["stable"].bval ? "release" : "snapshot");
+            e.id.assign_s(fv[i]["version"].str());
+            e.type.assign_s(fv[i]["stable"].boolean() ? "release" : "snapshot");
             entries.push_back(std::move(e));
         }
         fputs("Fetching Mojang manifest (needed for base download)...\n", stdout);
         Str mu{}; mu.assign_s(MANIFEST_URL);
         Str ms = http_get_str(mu);
-        if (!ms.empty()) manifest = parse_json(ms);
+        if (!ms.empty()) manifest_doc = parse_json(std::move(ms));
     } else {
         fputs("Fetching version manifest...\n", stdout);
         Str mu{}; mu.assign_s(MANIFEST_URL);
@@ -1764,12 +5261,12 @@ static void section_download(const WStr& root, Config& cfg, const WStr& cfg_path
             fputs("Failed to fetch manifest.\nPress Enter to continue...", stdout);
             getchar(); return;
         }
-        manifest = parse_json(ms);
-        entries.reserve(manifest["versions"].arr_n);
-        for (size_t i = 0; i < manifest["versions"].arr_n; ++i) {
+        manifest_doc = parse_json(std::move(ms));
+        entries.reserve(manifest["versions"].size());
+        for (size_t i = 0; i < manifest["versions"].size(); ++i) {
             VE e{};
-            e.id.assign_s(manifest["versions"].arr[i]["id"].str());
-            e.type.assign_s(manifest["versions"].arr[i]["type"].str());
+            e.id.assign_s(manifest["versions"][i]["id"].str());
+            e.type.assign_s(manifest["versions"][i]["type"].str());
             entries.push_back(std::move(e));
         }
     }
@@ -1817,7 +5314,7 @@ static void section_download(const WStr& root, Config& cfg, const WStr& cfg_path
         if (use_fabric) {
             printf("\nDownload Fabric for Minecraft %s? (y/n): ", chosen);
             Str ans = read_line();
-            if (ans.empty() || (ans.p[0] != 'y' && ans.p[0] != 'Y')) return;
+            if (ans.empty() || (ans.data()[0] != 'y' && ans.data()[0] != 'Y')) return;
             if (!install_bundled_jre(root, cfg, cfg_path, chosen))
                 fputs("Continuing without bundled JRE.\n", stdout);
             if (manifest.is_null()) {
@@ -1835,10 +5332,10 @@ static void section_download(const WStr& root, Config& cfg, const WStr& cfg_path
             } else {
                 printf("\nDownload Minecraft %s? (y/n): ", chosen);
                 Str ans = read_line();
-                if (ans.empty() || (ans.p[0] != 'y' && ans.p[0] != 'Y')) return;
+                if (ans.empty() || (ans.data()[0] != 'y' && ans.data()[0] != 'Y')) return;
                 if (!install_bundled_jre(root, cfg, cfg_path, chosen))
                     fputs("Continuing without bundled JRE.\n", stdout);
-                fputs("\n[1/5] Manifest already fetched.\n", stdout);
+                fputs("\n[1/3] Manifest already fetched.\n", stdout);
                 if (!download_minecraft_base(root, chosen, manifest))
                     fputs("\nDownload failed.\n", stderr);
                 else
@@ -1850,21 +5347,63 @@ static void section_download(const WStr& root, Config& cfg, const WStr& cfg_path
     }
 }
 
+static void section_verify(const WStr& root) {
+    print_header("VERIFY / REPAIR");
+    Vec<Str> versions = get_installed_versions(root);
+    if (versions.empty()) {
+        fputs("\nNo installed versions.\nPress Enter to continue...", stdout);
+        getchar();
+        return;
+    }
+
+    fputs("\nInstalled versions:\n", stdout);
+    for (size_t i = 0; i < versions.n; ++i)
+        printf("  [%zu] %s\n", i + 1, versions.p[i].c_str());
+    fputs("\nSelect version (or 'q' to cancel): ", stdout);
+
+    Str input = read_line();
+    if (input.eq("q") || input.eq("Q")) return;
+
+    int idx = -1;
+    if (!parse_int(input, &idx) || idx < 1 || idx > (int)versions.n) {
+        fputs("Invalid selection.\nPress Enter to continue...", stdout);
+        getchar(); return;
+    }
+
+    const char* chosen = versions.p[idx - 1].c_str();
+    printf("\nVerifying %s...\n", chosen);
+    if (verify_install(root, chosen, true)) printf("\n%s is intact.\n", chosen);
+    fputs("Press Enter to continue...", stdout);
+    getchar();
+}
+
 static void section_settings(Config& cfg, const WStr& cfg_path) {
     for (;;) {
         print_header("SETTINGS");
+        char bg[32];
+        if (cfg.bg_kbps) snprintf(bg, sizeof(bg), "%d KB/s", cfg.bg_kbps);
+        else             snprintf(bg, sizeof(bg), "unlimited");
         printf("  [1] Username      : %s\n"
                "  [2] RAM (GB)      : %dGB\n"
                "  [3] Java Path     : %s\n"
                "  [4] Java Args     : %s\n"
                "  [5] Hide Launcher : %s\n"
                "  [6] Show Console  : %s\n"
-               "  [7] Back\n\nChoice: ",
+               "  [7] Verify Launch : %s\n"
+               "  [8] Shared Store  : %s\n"
+               "  [9] Connections   : %d-%d\n"
+               " [10] Early Launch  : %s\n"
+               " [11] Background    : %s\n"
+               " [12] Back\n\nChoice: ",
                cfg.username.c_str(), cfg.ram_gb,
                cfg.java_path.c_str(),
                cfg.java_args.empty() ? "(none)" : cfg.java_args.c_str(),
                cfg.hide_launcher ? "ON" : "OFF",
-               cfg.show_console  ? "ON" : "OFF");
+               cfg.show_console  ? "ON" : "OFF",
+               cfg.verify_on_launch ? "ON" : "OFF",
+               cfg.store_path.empty() ? "OFF" : cfg.store_path.c_str(),
+               cfg.dl_min, cfg.dl_max,
+               cfg.early_launch ? "ON" : "OFF", bg);
 
         Str input = read_line();
 
@@ -1896,7 +5435,39 @@ static void section_settings(Config& cfg, const WStr& cfg_path) {
             cfg.hide_launcher = !cfg.hide_launcher;
         } else if (input.eq("6")) {
             cfg.show_console = !cfg.show_console;
-        } else if (input.eq("7") || input.eq("q") || input.eq("Q")) {
+        } else if (input.eq("7")) {
+            cfg.verify_on_launch = !cfg.verify_on_launch;
+        } else if (input.eq("8")) {
+            printf("Shared store folder, '-' to turn off [%s]: ",
+                   cfg.store_path.empty() ? "off" : cfg.store_path.c_str());
+            Str val = read_line();
+            if (val.eq("-")) cfg.store_path.clear();
+            else if (!val.empty()) cfg.store_path = std::move(val);
+            g_store = to_wide_str(cfg.store_path.c_str());
+        } else if (input.eq("9")) {
+            int lo = 0, hi = 0;
+            printf("Minimum connections [%d]: ", cfg.dl_min);
+            Str a = read_line();
+            printf("Maximum connections [%d]: ", cfg.dl_max);
+            Str b = read_line();
+            if (!parse_int(a, &lo)) lo = cfg.dl_min;
+            if (!parse_int(b, &hi)) hi = cfg.dl_max;
+            if (lo >= 1 && hi >= lo && hi <= 256) { cfg.dl_min = lo; cfg.dl_max = hi; }
+            else fputs("Invalid. Need 1 <= min <= max <= 256.\n", stdout);
+            g_dl_min = cfg.dl_min; g_dl_max = cfg.dl_max;
+        } else if (input.eq("10")) {
+            cfg.early_launch = !cfg.early_launch;
+            g_early_launch = cfg.early_launch;
+        } else if (input.eq("11")) {
+            printf("Background download limit in KB/s, 0 for none [%d]: ", cfg.bg_kbps);
+            Str val = read_line();
+            int kb = 0;
+            if (parse_int(val, &kb)) {
+                if (kb >= 0) cfg.bg_kbps = kb;
+                else fputs("Invalid. Must be 0 or more.\n", stdout);
+            }
+            g_bg_kbps = cfg.bg_kbps;
+        } else if (input.eq("12") || input.eq("q") || input.eq("Q")) {
             break;
         }
         save_config(cfg, cfg_path);
@@ -1977,11 +5548,9 @@ static void section_launch(const WStr& root, Config& cfg, const WStr& cfg_path)
     {
         Str vjname{}; vjname.assign_s(chosen); vjname.append_s(".json");
         WStr vj_path = pjoin(pjoin(pjoin(root, "versions"), chosen), vjname.c_str());
-        if (path_exists(vj_path)) {
-            Str vs = read_file(vj_path);
-            JVal jv = parse_json(vs);
-            if (jv.has("inheritsFrom")) base_ver.assign_s(jv["inheritsFrom"].str());
-        }
+        JDoc doc = load_json_cached(vj_path);
+        const JVal& jv = doc.root;
+        if (jv.has("inheritsFrom")) base_ver.assign_s(jv["inheritsFrom"].str());
     }
     if (!check_java(cfg.java_path)) {
         printf("\nJava not found at: %s\nLocating bundled JRE...\n", cfg.java_path.c_str());
@@ -1990,9 +5559,25 @@ static void section_launch(const WStr& root, Config& cfg, const WStr& cfg_path)
             getchar(); return;
         }
     }
+    if (cfg.verify_on_launch) {
+        if (g_bg_run) printf("\nVerifying %s (assets are still downloading)...\n", chosen);
+        else          printf("\nVerifying %s...\n", chosen);
+        if (!verify_install(root, chosen, false, !g_bg_run))
+            fputs("Install is incomplete; launching anyway.\n", stderr);
+    }
     if (!launch_version(root, cfg, chosen)) {
         fputs("Press Enter to continue...", stdout);
         getchar();
+    } else if (cfg.hide_launcher && g_bg_run) {
+        // Exiting would cut off the background downloads, so say what is
+        // being waited for; dl_run_finish shows the count as it goes.
+        LONG left = g_bg_run->q.total - g_bg_run->ndone;
+        fputs("Game launched!\n", stdout);
+        if (g_bg_kbps) printf("Finishing %ld asset file(s) in the background at up to %d KB/s before exiting.\n", left, g_bg_kbps);
+        else           printf("Finishing %ld asset file(s) in the background before exiting.\n", left);
+        fputs("Closing this window stops them; Verify/Repair fetches the rest later.\n", stdout);
+        dl_background_wait(false);
+        exit(0);
     } else {
         fputs("Game launched! Exiting launcher...\n", stdout);
         Sleep(1500);
@@ -2026,7 +5611,6 @@ int main() {
     SetConsoleOutputCP(CP_UTF8);
     SetConsoleTitleW(L"GoonMC by TryFast");
     init_console();
-    InitializeCriticalSection(&g_mkdir_cs);
 
     wchar_t exe[MAX_PATH]{};
     GetModuleFileNameW(nullptr, exe, MAX_PATH);
@@ -2040,6 +5624,9 @@ int main() {
 
     g_theme_color = cfg.theme_color;
     apply_theme();
+    g_store = to_wide_str(cfg.store_path.c_str());
+    g_dl_min = cfg.dl_min; g_dl_max = cfg.dl_max;
+    g_early_launch = cfg.early_launch; g_bg_kbps = cfg.bg_kbps;
 
     if (cfg.username.empty() || cfg.username.eq("Player")) {
         fputs("=== GoonMC by TryFast ===\n\nEnter your username: ", stdout);
@@ -2051,15 +5638,17 @@ int main() {
 
     for (;;) {
         print_header("GoonMC by TryFast");
-        fputs("  [1] Launch\n  [2] Download\n  [3] Settings\n  [4] Themes\n  [5] Exit\n\nChoice: ", stdout);
+        fputs("  [1] Launch\n  [2] Download\n  [3] Settings\n  [4] Themes\n  [5] Exit\n"
+              "  [6] Verify/Repair\n\nChoice: ", stdout);
         Str input = read_line();
         if      (input.eq("1")) section_launch(root, cfg, cfg_path);
         else if (input.eq("2")) section_download(root, cfg, cfg_path);
         else if (input.eq("3")) section_settings(cfg, cfg_path);
         else if (input.eq("4")) section_themes(cfg, cfg_path);
         else if (input.eq("5") || input.eq("q") || input.eq("Q")) break;
+        else if (input.eq("6")) section_verify(root);
     }
+    dl_background_wait();
 
-    DeleteCriticalSection(&g_mkdir_cs);
     return 0;
 }
\ No newline at end of file